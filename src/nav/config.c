@@ -12,6 +12,7 @@
 #include "nav/event/fs.h"
 #include "nav/event/hook.h"
 #include "nav/util.h"
+#include "nav/plugins/jobs/jobs.h"
 
 static Cmdret conf_augroup();
 static Cmdret conf_autocmd();
@@ -28,6 +29,7 @@ static Cmd_T cmdtable[] = {
   {"augroup","aug",  "Define autocmd group.",       conf_augroup,    0},
   {"autocmd","au",   "Add command to an event.",    conf_autocmd,    0},
   {"highlight","hi", "Define a highlight group.",   conf_color,      0},
+  {"job",0,          "Pause or cancel a file job.", jobs_ctl,        0},
   {"let",0,          "Set variable to expression.", conf_variable,   0},
   {"kill",0,         "Kill a pid.",                 op_kill,         0},
   {"map",0,          "Map {lhs} to {rhs}.",         conf_mapping,    0, 1},
@@ -0,0 +1,132 @@
+//blocking file data copy, reflink first and read/write last
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <uv.h>
+#include "nav/event/copy.h"
+#include "nav/macros.h"
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#define CHUNK_MIN  (1 << 20)
+#define CHUNK_MAX  (64 << 20)
+#define CHUNK_FAST 50   /* ms; a quicker step doubles the next */
+#define CHUNK_SLOW 400  /* ms; a slower step halves the next */
+#define RW_BUF     (1 << 20)
+
+void copy_init(CopyState *cs)
+{
+  cs->method = COPY_CLONE;
+  cs->chunk = CHUNK_MIN;
+  cs->buf = NULL;
+}
+
+void copy_free(CopyState *cs)
+{
+  free(cs->buf);
+  cs->buf = NULL;
+}
+
+/* errors that mean the method cannot serve these files, not that the
+ * copy failed */
+static int unsupported(int err)
+{
+  return err == EXDEV || err == EINVAL || err == ENOSYS ||
+    err == EOPNOTSUPP || err == ENOTTY || err == EBADF || err == EPERM;
+}
+
+static ssize_t copy_rw(CopyState *cs, int in, int out, uint64_t off)
+{
+  if (!cs->buf)
+    cs->buf = malloc(RW_BUF);
+
+  ssize_t n = pread(in, cs->buf, MIN(cs->chunk, RW_BUF), off);
+  if (n <= 0)
+    return n;
+
+  ssize_t done = 0;
+  while (done < n) {
+    ssize_t w = pwrite(out, cs->buf + done, n - done, off + done);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w < 0)
+      return -1;
+    done += w;
+  }
+  return done;
+}
+
+static ssize_t copy_once(CopyState *cs, int in, int out, uint64_t off,
+    uint64_t len)
+{
+  ssize_t ret;
+  for (;;) {
+    switch (cs->method) {
+      case COPY_CLONE:
+#ifdef FICLONE
+        if (off == 0 && ioctl(out, FICLONE, in) == 0)
+          return len;
+#endif
+        cs->method++;
+        break;
+      case COPY_RANGE:
+#ifdef __NR_copy_file_range
+      {
+        loff_t ioff = off, ooff = off;
+        ret = syscall(__NR_copy_file_range, in, &ioff, out, &ooff,
+            cs->chunk, 0);
+        /* procfs, sysfs and some fuse give 0 here for data a read
+         * returns, so with bytes left a 0 only ends the copy from COPY_RW */
+        if (ret > 0 || len == 0)
+          return ret;
+        if (ret == 0)
+          errno = EINVAL;
+        if (errno == EINTR)
+          break;
+        if (!unsupported(errno))
+          return -errno;
+      }
+#endif
+        cs->method++;
+        break;
+      case COPY_SENDFILE:
+      {
+        off_t soff = off;
+        ret = sendfile(out, in, &soff, cs->chunk);
+        if (ret > 0 || len == 0)
+          return ret;
+        if (ret == 0)
+          errno = EINVAL;
+        else if (errno == EINTR || errno == EAGAIN)
+          break;
+        if (!unsupported(errno))
+          return -errno;
+        cs->method++;
+        break;
+      }
+      default:
+        ret = copy_rw(cs, in, out, off);
+        if (ret < 0 && errno == EINTR)
+          break;
+        return ret < 0 ? -errno : ret;
+    }
+  }
+}
+
+ssize_t copy_step(CopyState *cs, int in, int out, uint64_t off, uint64_t len)
+{
+  uint64_t before = uv_hrtime();
+  ssize_t ret = copy_once(cs, in, out, off, len);
+
+  uint64_t ms = (uv_hrtime() - before) / 1000000;
+  if (ret == (ssize_t)cs->chunk && ms < CHUNK_FAST && cs->chunk < CHUNK_MAX)
+    cs->chunk *= 2;
+  else if (ms > CHUNK_SLOW && cs->chunk > CHUNK_MIN)
+    cs->chunk /= 2;
+  return ret;
+}
@@ -0,0 +1,30 @@
+#ifndef NV_EVENT_COPY_H
+#define NV_EVENT_COPY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* fastest first; a method that cannot serve a pair of files falls
+ * through to the next for the rest of the transfer. */
+enum copy_method {
+  COPY_CLONE,     //FICLONE reflink, whole file at once
+  COPY_RANGE,     //copy_file_range, in kernel
+  COPY_SENDFILE,
+  COPY_RW,        //pread/pwrite through buf
+};
+
+typedef struct {
+  int method;
+  size_t chunk;   //bytes asked of the next step
+  char *buf;      //COPY_RW bounce buffer
+} CopyState;
+
+void copy_init(CopyState *cs);
+void copy_free(CopyState *cs);
+
+/* copy up to cs->chunk bytes from off, blocking. len is the bytes left
+ * in the file from off. returns bytes copied, 0 at end of input or
+ * -errno. the chunk adapts to how long a step took. */
+ssize_t copy_step(CopyState *cs, int in, int out, uint64_t off, uint64_t len);
+
+#endif
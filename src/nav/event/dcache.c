@@ -0,0 +1,326 @@
+//on-disk cache of directory listings, read through mmap
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "nav/event/dcache.h"
+#include "nav/lib/uthash.h"
+#include "nav/log.h"
+
+#define DC_MAGIC   0x4344564e  /* NVDC */
+#define DC_VERSION 2
+#define DC_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ndirs;
+  uint32_t pad;
+} DcHeader;
+
+typedef struct {
+  uint32_t size;      //record bytes, entries included
+  uint32_t count;
+  DirKey key;
+  int64_t used;       //last session that read or wrote it
+  uint32_t pathlen;   //with nul
+  uint32_t pad;
+  char path[];
+} DcDir;
+
+/* every stat field the ui can show, so a cached listing that is not
+ * rescanned draws the same as a fresh one */
+typedef struct {
+  int64_t size;
+  int64_t blocks;
+  int64_t atime;
+  int64_t mtime;
+  int64_t ctime;
+  uint32_t atime_ns;
+  uint32_t mtime_ns;
+  uint32_t ctime_ns;
+  uint32_t mode;
+  uint64_t ino;
+  uint64_t dev;
+  uint64_t rdev;
+  uint64_t nlink;
+  uint32_t uid;
+  uint32_t gid;
+  uint32_t blksize;
+  uint32_t namelen;   //with nul
+  char name[];
+} DcEnt;
+
+typedef struct {
+  char *key;          //points into the map
+  DcDir *dir;
+  UT_hash_handle hh;
+} DcIndex;
+
+struct DcWriter {
+  FILE *f;
+  char *file;
+  char *tmp;
+  uint32_t ndirs;
+  long start;         //offset of the open dir record, or -1
+};
+
+static char *map_file;
+static void *map;
+static size_t map_len;
+static DcIndex *index_tbl;
+
+static bool in_map(const void *p, size_t len)
+{
+  const char *c = p;
+  return c >= (char*)map && c + len <= (char*)map + map_len;
+}
+
+/* index every well formed record. a damaged tail is ignored. */
+static void build_index()
+{
+  DcHeader *hdr = map;
+  char *p = (char*)map + sizeof(DcHeader);
+  for (uint32_t i = 0; i < hdr->ndirs; i++) {
+    DcDir *dir = (DcDir*)p;
+    if (!in_map(dir, sizeof(DcDir)) || dir->size < sizeof(DcDir) ||
+        !in_map(dir, dir->size))
+      break;
+    if (!dir->pathlen || !in_map(dir->path, dir->pathlen) ||
+        dir->path[dir->pathlen - 1] != '\0')
+      break;
+
+    DcIndex *ind = malloc(sizeof(DcIndex));
+    ind->key = dir->path;
+    ind->dir = dir;
+    HASH_ADD_KEYPTR(hh, index_tbl, ind->key, strlen(ind->key), ind);
+    p += dir->size;
+  }
+}
+
+void dcache_open(const char *file)
+{
+  if (map_file && !strcmp(map_file, file))
+    return;
+  dcache_close();
+  map_file = strdup(file);
+
+  int fd = open(file, O_RDONLY);
+  if (fd == -1)
+    return;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(DcHeader)) {
+    close(fd);
+    return;
+  }
+
+  map_len = st.st_size;
+  map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    map = NULL;
+    return;
+  }
+
+  DcHeader *hdr = map;
+  if (hdr->magic != DC_MAGIC || hdr->version != DC_VERSION) {
+    log_msg("DCACHE", "stale format %s", file);
+    return;
+  }
+  build_index();
+  log_msg("DCACHE", "opened %s: %d dirs", file, HASH_COUNT(index_tbl));
+}
+
+void dcache_close()
+{
+  DcIndex *it, *tmp;
+  HASH_ITER(hh, index_tbl, it, tmp) {
+    HASH_DEL(index_tbl, it);
+    free(it);
+  }
+  if (map)
+    munmap(map, map_len);
+  map = NULL;
+  map_len = 0;
+  free(map_file);
+  map_file = NULL;
+}
+
+bool dcache_read(const char *dir, DirKey *key, dcache_ent_cb cb, void *arg)
+{
+  DcIndex *ind;
+  HASH_FIND_STR(index_tbl, dir, ind);
+  if (!ind)
+    return false;
+
+  DcDir *rec = ind->dir;
+  char *end = (char*)rec + rec->size;
+  char *p = rec->path + DC_ALIGN(rec->pathlen);
+  *key = rec->key;
+  if (!cb)
+    return true;
+
+  for (uint32_t i = 0; i < rec->count; i++) {
+    DcEnt *e = (DcEnt*)p;
+    if ((char*)e + sizeof(DcEnt) > end || !e->namelen ||
+        e->name + e->namelen > end || e->name[e->namelen - 1] != '\0')
+      break;
+
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode    = e->mode;
+    st.st_size    = e->size;
+    st.st_blocks  = e->blocks;
+    st.st_ino     = e->ino;
+    st.st_dev     = e->dev;
+    st.st_rdev    = e->rdev;
+    st.st_nlink   = e->nlink;
+    st.st_uid     = e->uid;
+    st.st_gid     = e->gid;
+    st.st_blksize = e->blksize;
+    st.st_atim = (struct timespec){e->atime, e->atime_ns};
+    st.st_mtim = (struct timespec){e->mtime, e->mtime_ns};
+    st.st_ctim = (struct timespec){e->ctime, e->ctime_ns};
+    cb(arg, e->name, &st);
+    p = e->name + DC_ALIGN(e->namelen);
+  }
+  return true;
+}
+
+static void put_pad(DcWriter *w, size_t len)
+{
+  static const char zero[8];
+  fwrite(zero, 1, DC_ALIGN(len) - len, w->f);
+}
+
+DcWriter* dcache_begin(const char *file)
+{
+  DcWriter *w = malloc(sizeof(DcWriter));
+  w->file = strdup(file);
+  asprintf(&w->tmp, "%s.%d", file, getpid());
+  w->ndirs = 0;
+  w->start = -1;
+  w->f = fopen(w->tmp, "w");
+  if (!w->f) {
+    log_err("DCACHE", "cannot write %s", w->tmp);
+    free(w->file);
+    free(w->tmp);
+    free(w);
+    return NULL;
+  }
+
+  DcHeader hdr = {DC_MAGIC, DC_VERSION, 0, 0};
+  fwrite(&hdr, sizeof(hdr), 1, w->f);
+  return w;
+}
+
+/* size is only known once the entries are written */
+static void close_dir(DcWriter *w)
+{
+  if (w->start == -1)
+    return;
+  long end = ftell(w->f);
+  uint32_t size = end - w->start;
+  fseek(w->f, w->start + offsetof(DcDir, size), SEEK_SET);
+  fwrite(&size, sizeof(size), 1, w->f);
+  fseek(w->f, end, SEEK_SET);
+  w->start = -1;
+}
+
+/* the caller follows with count dcache_ent calls */
+void dcache_dir(DcWriter *w, const char *dir, DirKey *key, int count)
+{
+  close_dir(w);
+  DcDir rec = {
+    .count   = count,
+    .key     = *key,
+    .used    = time(NULL),
+    .pathlen = strlen(dir) + 1,
+  };
+  w->ndirs++;
+  w->start = ftell(w->f);
+  fwrite(&rec, sizeof(rec), 1, w->f);
+  fwrite(dir, 1, rec.pathlen, w->f);
+  put_pad(w, rec.pathlen);
+}
+
+void dcache_ent(DcWriter *w, const char *name, struct stat *st)
+{
+  DcEnt e = {
+    .size     = st->st_size,
+    .blocks   = st->st_blocks,
+    .atime    = st->st_atim.tv_sec,
+    .mtime    = st->st_mtim.tv_sec,
+    .ctime    = st->st_ctim.tv_sec,
+    .atime_ns = st->st_atim.tv_nsec,
+    .mtime_ns = st->st_mtim.tv_nsec,
+    .ctime_ns = st->st_ctim.tv_nsec,
+    .mode     = st->st_mode,
+    .ino      = st->st_ino,
+    .dev      = st->st_dev,
+    .rdev     = st->st_rdev,
+    .nlink    = st->st_nlink,
+    .uid      = st->st_uid,
+    .gid      = st->st_gid,
+    .blksize  = st->st_blksize,
+    .namelen  = strlen(name) + 1,
+  };
+  fwrite(&e, sizeof(e), 1, w->f);
+  fwrite(name, 1, e.namelen, w->f);
+  put_pad(w, e.namelen);
+}
+
+static int by_used(const void *a, const void *b)
+{
+  int64_t ua = (*(DcIndex**)a)->dir->used;
+  int64_t ub = (*(DcIndex**)b)->dir->used;
+  return ua < ub ? 1 : ua > ub ? -1 : 0;
+}
+
+/* carry over listings from the mapped file not rewritten this session,
+ * most recently used first, until room entries are spent. those unused
+ * since the cutoff are dropped. */
+void dcache_keep(DcWriter *w, bool (*skip)(const char *dir), int room,
+    time_t since)
+{
+  close_dir(w);
+  int n = 0;
+  DcIndex **keep = malloc(HASH_COUNT(index_tbl) * sizeof(DcIndex*));
+  DcIndex *it, *tmp;
+  HASH_ITER(hh, index_tbl, it, tmp) {
+    if (!skip(it->key) && it->dir->used >= since)
+      keep[n++] = it;
+  }
+  qsort(keep, n, sizeof(DcIndex*), by_used);
+
+  for (int i = 0; i < n && room > 0; i++) {
+    DcDir *dir = keep[i]->dir;
+    if ((int)dir->count > room)
+      continue;
+    room -= dir->count;
+    fwrite(dir, 1, dir->size, w->f);
+    w->ndirs++;
+  }
+  free(keep);
+}
+
+void dcache_end(DcWriter *w)
+{
+  close_dir(w);
+  fseek(w->f, offsetof(DcHeader, ndirs), SEEK_SET);
+  fwrite(&w->ndirs, sizeof(w->ndirs), 1, w->f);
+
+  bool ok = !ferror(w->f);
+  ok = !fclose(w->f) && ok;
+  if (!ok || rename(w->tmp, w->file) == -1) {
+    log_err("DCACHE", "failed to save %s", w->file);
+    unlink(w->tmp);
+  }
+  free(w->file);
+  free(w->tmp);
+  free(w);
+}
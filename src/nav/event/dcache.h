@@ -0,0 +1,31 @@
+#ifndef NV_EVENT_DCACHE_H
+#define NV_EVENT_DCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/* a directory listing is valid while these are unchanged */
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  struct timespec mtime;
+  struct timespec ctime;
+} DirKey;
+
+typedef struct DcWriter DcWriter;
+typedef void (*dcache_ent_cb)(void *arg, const char *name, struct stat *st);
+
+void dcache_open(const char *file);
+void dcache_close();
+bool dcache_read(const char *dir, DirKey *key, dcache_ent_cb cb, void *arg);
+
+DcWriter* dcache_begin(const char *file);
+void dcache_dir(DcWriter *w, const char *dir, DirKey *key, int count);
+void dcache_ent(DcWriter *w, const char *name, struct stat *st);
+void dcache_keep(DcWriter *w, bool (*skip)(const char *dir), int room,
+    time_t since);
+void dcache_end(DcWriter *w);
+
+#endif
@@ -1,5 +1,6 @@
 //file copy and move, including queues and callback per request
 #include <unistd.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <libgen.h>
@@ -10,40 +11,103 @@
 #include "nav/event/event.h"
 #include "nav/event/fs.h"
 #include "nav/event/ftw.h"
+#include "nav/event/copy.h"
+#include "nav/event/trash.h"
+#include "nav/event/ioprio.h"
+#include "nav/event/workq.h"
 #include "nav/tui/buffer.h"
+#include "nav/tui/message.h"
+#include "nav/plugins/jobs/jobs.h"
+#include "nav/option.h"
+#include "nav/lib/uthash.h"
 
-static void write_cb(uv_fs_t *);
-static void do_stat(const char *, struct stat *);
+typedef struct Xfer Xfer;
+
+static void write_cb(WorkReq *);
+static void do_stat(Xfer *, const char *, struct stat *);
 static void file_check_update();
-static void do_unlink(const char *, bool);
+static void do_unlink(FileGroup *, const char *, bool);
+static void file_close(Xfer *);
+static void try_copy(Xfer *);
 
 #define FFRESH O_CREAT|O_EXCL|O_WRONLY
-
-typedef struct File File;
-struct File {
-  uv_fs_t w1;         //writer
+#define RATE_SAMPLE 250   /* ms between rate samples */
+#define RATE_TAU    2000  /* ms; EWMA time constant */
+#define STALL_WAIT  5000  /* ms without progress before a job is stalled */
+#define PACE_MIN    (64 << 10) /* smallest step under copyrate */
+
+/* one item in flight. each runs its own stat, open, copy and close
+ * requests; up to copyjobs of them run at once. copy steps run on the
+ * copy queue rather than the libuv pool, which scans share. */
+struct Xfer {
+  TAILQ_ENTRY(Xfer) ent; //parked or paced
+  WorkReq w1;         //writer
   uv_fs_t f1, f2;     //src, dest
   uv_fs_t c1, c2;     //close
   uv_fs_t m1;         //version scan
   uv_file u1, u2;     //file handles
+  int opening;        //opens in flight
   int opencnt;        //ref_count files1,2
-  bool running;
+  bool err;           //an open failed
+  bool created;       //dest was opened fresh
+  bool dropped;       //cancelled, a created dest is removed
   uint64_t len;       //file length
   uint64_t offset;    //write offset
-  uint64_t blk;       //write blk size
-  uint64_t before;    //last eventloop time
+  ssize_t wret;       //bytes of the last copy step, or -errno
+  CopyState cs;
   struct stat s1, s2; //file stat
   FileItem  *cur;     //current fileitem
-  FileGroup *fg;      //current filegroup
+  FileGroup *fg;      //owning filegroup
+};
+
+/* xfers in flight on one device, kept while a lane uses it */
+typedef struct {
+  dev_t dev;
+  int active;
+  int lanes;
+  UT_hash_handle hh;
+} DevLoad;
+
+/* groups between one pair of devices. pairs are served in turn, each
+ * held to devjobs per device, so a slow disk leaves others running. */
+struct Lane {
+  TAILQ_ENTRY(Lane) ent;
+  TAILQ_HEAD(LaneGroups, FileGroup) p;
+  DevLoad *src;
+  DevLoad *dst;
+};
+
+typedef struct File File;
+struct File {
+  int active;         //xfers in flight
+  bool queued;        //file_start event pending
+  uint64_t before;    //last progress update
   TAILQ_HEAD(Groups, FileGroup) p;
+  TAILQ_HEAD(Lanes, Lane) lanes;
+  TAILQ_HEAD(Parked, Xfer) parked;
+  TAILQ_HEAD(Paced, Xfer) paced;  //waiting on copyrate
+  uv_timer_t pace;
+  double tokens;      //bytes the copyrate bucket holds, or owes
+  uint64_t filled;    //last refill, 0 while no rate is set
+  DevLoad *devs;
+  uv_timer_t tick;    //samples rates while groups run
+  WorkQ *copyq;       //copy steps, copyjobs threads
+  int ids;
 };
 static File file;
 static char target[PATH_MAX];
 
 void file_init()
 {
-  file.running = false;
+  file.active = 0;
+  file.queued = false;
   TAILQ_INIT(&file.p);
+  TAILQ_INIT(&file.lanes);
+  TAILQ_INIT(&file.parked);
+  TAILQ_INIT(&file.paced);
+  uv_timer_init(eventloop(), &file.tick);
+  uv_timer_init(eventloop(), &file.pace);
+  file.copyq = workq_new(get_opt_uint("copyjobs"));
   ftw_init();
 }
 
@@ -52,6 +116,76 @@ void file_cleanup()
   //prompt to cancel queued items.
   //cancel items
   ftw_cleanup();
+  workq_free(file.copyq);
+}
+
+static DevLoad* dev_load(dev_t dev)
+{
+  DevLoad *load;
+  HASH_FIND(hh, file.devs, &dev, sizeof(dev_t), load);
+  if (!load) {
+    load = calloc(1, sizeof(DevLoad));
+    load->dev = dev;
+    HASH_ADD(hh, file.devs, dev, sizeof(dev_t), load);
+  }
+  load->lanes++;
+  return load;
+}
+
+static void dev_put(DevLoad *load)
+{
+  if (--load->lanes > 0)
+    return;
+  HASH_DEL(file.devs, load);
+  free(load);
+}
+
+static Lane* lane_get(dev_t src, dev_t dst)
+{
+  Lane *lane;
+  TAILQ_FOREACH(lane, &file.lanes, ent) {
+    if (lane->src->dev == src && lane->dst->dev == dst)
+      return lane;
+  }
+  lane = malloc(sizeof(Lane));
+  TAILQ_INIT(&lane->p);
+  lane->src = dev_load(src);
+  lane->dst = dev_load(dst);
+  TAILQ_INSERT_TAIL(&file.lanes, lane, ent);
+  return lane;
+}
+
+/* the last group of a lane leaves with no xfer in flight */
+static void lane_leave(FileGroup *fg)
+{
+  Lane *lane = fg->lane;
+  if (!lane)
+    return;
+  TAILQ_REMOVE(&lane->p, fg, lent);
+  if (!TAILQ_EMPTY(&lane->p))
+    return;
+  TAILQ_REMOVE(&file.lanes, lane, ent);
+  dev_put(lane->src);
+  dev_put(lane->dst);
+  free(lane);
+}
+
+static void lane_load(Lane *lane, int n)
+{
+  lane->src->active += n;
+  if (lane->dst != lane->src)
+    lane->dst->active += n;
+}
+
+static bool lane_full(Lane *lane, int max)
+{
+  return lane->src->active >= max || lane->dst->active >= max;
+}
+
+/* the sizing thread reads cancel too, so every access is atomic */
+static bool fg_cancelled(FileGroup *fg)
+{
+  return __atomic_load_n(&fg->cancel, __ATOMIC_RELAXED);
 }
 
 static FileGroup* fg_new(Buffer *owner, int flags)
@@ -60,106 +194,161 @@ static FileGroup* fg_new(Buffer *owner, int flags)
   TAILQ_INIT(&fg->p);
   fg->owner = owner;
   fg->flags = flags;
+  fg->io = ioprio_job();
   return fg;
 }
 
-static void clear_fileitem(FileItem *item, bool isdir)
+static void clear_fileitem(FileGroup *fg, FileItem *item, bool isdir)
 {
   if (item->refs != 0)
     return;
 
-  do_unlink(item->src, isdir);
+  if (!item->dropped)
+    do_unlink(fg, item->src, isdir);
 
+  /* a dropped child can leave a parent that is still in flight */
   FileItem *parent = item->parent;
   if (parent) {
     parent->refs--;
-    clear_fileitem(parent, true);
+    if (parent->made)
+      clear_fileitem(fg, parent, true);
   }
   free(item->src);
   free(item->dest);
   free(item);
 }
 
-static void try_clear_filegroup()
+/* drop a ref held from outside the queue. once made, the item is
+ * waiting only on refs. */
+void file_release(FileGroup *fg, FileItem *item, bool isdir)
 {
-  if (TAILQ_EMPTY(&file.fg->p)) {
-    TAILQ_REMOVE(&file.p, file.fg, ent);
-
-    /* flush progress */
-    file.before = MAX_WAIT;
-    file_check_update();
+  item->refs--;
+  if (item->made)
+    clear_fileitem(fg, item, isdir);
+}
 
-    free(file.fg);
-    file.fg = NULL;
-  }
-  else
-    file_check_update();
+static void file_queue_start()
+{
+  if (file.queued)
+    return;
+  file.queued = true;
+  CREATE_EVENT(eventq(), file_start, 0, NULL);
 }
 
-static void file_stop()
+static void file_stop(Xfer *x)
 {
   log_msg("FILE", "close");
   //TODO: chmod
 
-  TAILQ_REMOVE(&file.fg->p, file.cur, ent);
-  clear_fileitem(file.cur, S_ISDIR(file.s1.st_mode));
-  try_clear_filegroup();
+  FileGroup *fg = x->fg;
+  if (x->dropped) {
+    x->cur->dropped = true;
+    if (x->created && unlink(x->cur->dest) == -1)
+      log_err("FILE", "unlink partial %s: %s", x->cur->dest, strerror(errno));
+  }
+  x->cur->made = true;
+  fg->files += !x->dropped;
+  clear_fileitem(fg, x->cur, S_ISDIR(x->s1.st_mode));
+  fg->active--;
+  file.active--;
+  lane_load(fg->lane, -1);
+  file_check_update();
 
-  memset(&file.s1, 0, sizeof(struct stat));
-  memset(&file.s2, 0, sizeof(struct stat));
+  copy_free(&x->cs);
+  uv_fs_req_cleanup(&x->f1);
+  uv_fs_req_cleanup(&x->f2);
+  uv_fs_req_cleanup(&x->c1);
+  uv_fs_req_cleanup(&x->c2);
+  free(x);
 
-  uv_fs_req_cleanup(&file.w1);
-  uv_fs_req_cleanup(&file.f1);
-  uv_fs_req_cleanup(&file.f2);
-  uv_fs_req_cleanup(&file.c1);
-  uv_fs_req_cleanup(&file.c2);
+  file_queue_start();
+}
 
-  file.running = false;
-  CREATE_EVENT(eventq(), file_start, 0, NULL);
+/* a paused copy holds its files open between steps, but gives up its
+ * slot to other groups */
+static void xfer_park(Xfer *x)
+{
+  TAILQ_INSERT_TAIL(&file.parked, x, ent);
+  file.active--;
+  lane_load(x->fg->lane, -1);
+  file_queue_start();
+}
+
+static void xfer_unpark(FileGroup *fg)
+{
+  Xfer *x, *tmp;
+  TAILQ_FOREACH_SAFE(x, &file.parked, ent, tmp) {
+    if (x->fg != fg)
+      continue;
+    TAILQ_REMOVE(&file.parked, x, ent);
+    file.active++;
+    lane_load(fg->lane, 1);
+    if (fg_cancelled(fg)) {
+      x->dropped = true;
+      file_close(x);
+    }
+    else
+      try_copy(x);
+  }
 }
 
-static void file_retry_as_copy()
+/* queued items of a cancelled group are let go unstarted */
+static void fg_drop(FileGroup *fg)
+{
+  FileItem *item;
+  while ((item = TAILQ_FIRST(&fg->p))) {
+    TAILQ_REMOVE(&fg->p, item, ent);
+    fg->queued--;
+    item->made = true;
+    item->dropped = true;
+    clear_fileitem(fg, item, false);
+  }
+}
+
+static void file_retry_as_copy(Xfer *x)
 {
   log_msg("FILE", "file_retry_as_copy");
 
-  char *src = file.cur->src;
-  char *dst = dirname(file.cur->dest);
+  char *src = x->cur->src;
+  char *dst = dirname(x->cur->dest);
   log_err("FILE", "retry %s %s", src, dst);
 
-  ftw_add_again(src, dst, fg_new(file.fg->owner, F_UNLINK));
-  file_stop();
+  ftw_add_again(src, dst, fg_new(x->fg->owner, F_UNLINK));
+  file_stop(x);
   ftw_retry();
 }
 
 static void close_cb(uv_fs_t *req)
 {
+  Xfer *x = req->data;
   if (req->result < 0)
     log_err("FILE", "close_cb: |%s|", uv_strerror(req->result));
 
-  file.opencnt--;
-  if (file.opencnt == 0)
-    file_stop();
+  x->opencnt--;
+  if (x->opencnt == 0)
+    file_stop(x);
 }
 
-static void do_unlink(const char *path, bool isdir)
+static void do_unlink(FileGroup *fg, const char *path, bool isdir)
 {
   log_msg("FILE", "do_unlink");
-  if (!BITMASK_CHECK(F_UNLINK, file.fg->flags))
+  if (!BITMASK_CHECK(F_UNLINK, fg->flags))
     return;
-  if (BITMASK_CHECK(F_ERROR, file.fg->flags))
+  if (BITMASK_CHECK(F_ERROR, fg->flags))
     return;
 
   log_msg("FILE", "unlink dir? %d", isdir);
-  if (isdir)
-    rmdir(path);
-  else
-    unlink(path);
+  unlinkat(AT_FDCWD, path, isdir ? AT_REMOVEDIR : 0);
 }
 
-static void file_close()
+static void file_close(Xfer *x)
 {
-  uv_fs_close(eventloop(), &file.c1, file.u1, close_cb);
-  uv_fs_close(eventloop(), &file.c2, file.u2, close_cb);
+  if (x->opencnt == 0)
+    return file_stop(x);
+  if (x->u1 != -1)
+    uv_fs_close(eventloop(), &x->c1, x->u1, close_cb);
+  if (x->u2 != -1)
+    uv_fs_close(eventloop(), &x->c2, x->u2, close_cb);
 }
 
 static int dest_ver(const char *base, const char *other, size_t baselen)
@@ -178,12 +367,13 @@ static int dest_ver(const char *base, const char *other, size_t baselen)
 
 static void scan_cb(uv_fs_t *req)
 {
+  Xfer *x = req->data;
   if (req->result < 0) {
     log_err("FILE", "scan_cb: |%s| ", uv_strerror(req->result));
     exit(1);
   }
-  char *path = strdup(file.cur->src);
-  char *base = strdup(basename(file.cur->dest));
+  char *path = strdup(x->cur->src);
+  char *base = strdup(basename(x->cur->dest));
   char *dir = dirname(path);
   int baselen = strlen(base);
   int max_ver = 0;
@@ -195,96 +385,302 @@ static void scan_cb(uv_fs_t *req)
       max_ver = ver;
   }
 
-  free(file.cur->dest);
-  asprintf(&file.cur->dest, "%s/%s_%d", dir, base, max_ver+1);
+  free(x->cur->dest);
+  asprintf(&x->cur->dest, "%s/%s_%d", dir, base, max_ver+1);
   free(path);
   free(base);
-  log_msg("FILE", "NEWVER: %s", file.cur->dest);
+  log_msg("FILE", "NEWVER: %s", x->cur->dest);
 
   uv_fs_req_cleanup(req);
-  do_stat(file.cur->dest, &file.s2);
+  do_stat(x, x->cur->dest, &x->s2);
 }
 
-static void find_dest_name()
+static void find_dest_name(Xfer *x)
 {
-  char *dir = dirname(strdup(file.cur->dest));
-  uv_fs_scandir(eventloop(), &file.m1, dir, 0, scan_cb);
+  char *dir = dirname(strdup(x->cur->dest));
+  uv_fs_scandir(eventloop(), &x->m1, dir, 0, scan_cb);
   free(dir);
 }
 
-static void try_sendfile()
+/* the copy threads only ever do background work */
+static void copy_work(WorkReq *req)
 {
-  while(1) {
-    int ret = uv_fs_sendfile(eventloop(),
-        &file.w1,
-        file.u2, file.u1,
-        file.offset, file.blk, write_cb);
-    if (ret > -1)
-      return;
-    if (ret == UV_EINTR || ret == UV_EAGAIN)
-      continue;
-  }
+  Xfer *x = req->data;
+  ioprio_thread(x->fg->io);
+  x->wret = copy_step(&x->cs, x->u1, x->u2, x->offset, x->len - x->offset);
+}
+
+static void try_copy(Xfer *x)
+{
+  workq_push(file.copyq, &x->w1, copy_work, write_cb);
+}
+
+static uint64_t fg_total(FileGroup *fg)
+{
+  return MAX(fg->tsize, fg->total);
+}
+
+static long fg_progress(FileGroup *fg)
+{
+  uint64_t total = fg_total(fg);
+  if (total < 1)
+    return 0;
+
+  long long sofar = fg->wsize * 100;
+  sofar /= total;
+  if (sofar > 100)
+    sofar = 100;
+  return sofar;
+}
+
+/* seconds left at the current rate, -1 when unknown. groups that
+ * write nothing go by files instead. */
+static long fg_eta(FileGroup *fg)
+{
+  uint64_t total = fg_total(fg);
+  if (total > fg->wsize && fg->rate.bps >= 1)
+    return (total - fg->wsize) / fg->rate.bps;
+
+  uint64_t files = MAX(fg->tfiles, fg->pfiles);
+  if (total == 0 && files > fg->files && fg->rate.fps > 0)
+    return (files - fg->files) / fg->rate.fps;
+  return total > fg->wsize || files > fg->files ? -1 : 0;
+}
+
+static const char* fg_kind(FileGroup *fg)
+{
+  if (BITMASK_CHECK(F_MOVE, fg->flags) ||
+      BITMASK_CHECK(F_COPY|F_UNLINK, fg->flags))
+    return "move";
+  if (BITMASK_CHECK(F_COPY, fg->flags))
+    return "copy";
+  return "remove";
+}
+
+/* nothing in flight is queued behind other work; in flight without
+ * progress is stalled */
+static const char* fg_state(FileGroup *fg, uint64_t now)
+{
+  if (fg_cancelled(fg))
+    return "cancelled";
+  if (fg->paused)
+    return "paused";
+  if (fg->sizing && fg->active == 0)
+    return "sizing";
+  if (fg->active == 0)
+    return "queued";
+  if ((now - fg->rate.moved) / 1000000 > STALL_WAIT)
+    return "stalled";
+  return NULL;
+}
+
+/* rates are an EWMA over RATE_TAU so a burst of small files does not
+ * swing the eta */
+static bool fg_sample(FileGroup *fg, uint64_t now)
+{
+  XferRate *r = &fg->rate;
+  double ms = (now - r->last) / 1000000.0;
+  if (ms < RATE_SAMPLE)
+    return false;
+
+  double a = r->last == r->start ? 1 : ms / (ms + RATE_TAU);
+  r->bps += a * ((fg->wsize - r->wlast) * 1000 / ms - r->bps);
+  r->fps += a * ((fg->files - r->flast) * 1000 / ms - r->fps);
+  if (fg->wsize != r->wlast || fg->files != r->flast)
+    r->moved = now;
+  r->wlast = fg->wsize;
+  r->flast = fg->files;
+  r->last = now;
+  return true;
+}
+
+static void fmt_eta(long secs, char *buf, size_t len)
+{
+  if (secs < 0)
+    snprintf(buf, len, "--:--");
+  else if (secs < 3600)
+    snprintf(buf, len, "%ld:%02ld", secs / 60, secs % 60);
+  else
+    snprintf(buf, len, "%ld:%02ld:%02ld",
+        secs / 3600, (secs / 60) % 60, secs % 60);
+}
+
+static void fg_publish(FileGroup *fg, uint64_t now)
+{
+  char rate[16], eta[16], *line;
+  readable_fs(fg->rate.bps, rate);
+  const char *state = fg_state(fg, now);
+  if (state)
+    snprintf(eta, sizeof(eta), "%s", state);
+  else
+    fmt_eta(fg_eta(fg), eta, sizeof(eta));
+
+  asprintf(&line, " %s/s %s ", rate, eta);
+  buf_update_xfer(fg->owner, line);
+  free(line);
+
+  asprintf(&line, "%-6s %+3d %3ld%% %7lu/%-7lu %7s/s %6.0f f/s %9s  %s",
+      fg_kind(fg), fg->prio, fg_progress(fg), fg->files, MAX(fg->tfiles, fg->pfiles),
+      rate, fg->rate.fps, eta, fg->label);
+  jobs_update(fg->id, line);
+  free(line);
 }
 
 static void file_check_update()
 {
   uint64_t now = os_hrtime();
   if ((now - file.before)/1000000 > MAX_WAIT) {
-    buf_update_progress(file.fg->owner, file_progress());
+    FileGroup *fg;
+    TAILQ_FOREACH(fg, &file.p, ent) {
+      if (fg_sample(fg, now))
+        fg_publish(fg, now);
+      buf_update_progress(fg->owner, fg_progress(fg));
+    }
     file.before = os_hrtime();
   }
 }
 
-static void write_cb(uv_fs_t *req)
+/* keeps rates falling while nothing completes */
+static void file_tick(uv_timer_t *handle)
 {
-  if (req->result < 0) {
-    log_err("FILE", "write_cb: |%s|", uv_strerror(req->result));
-    file.fg->flags |= F_ERROR;
-    return file_close();
+  file_check_update();
+}
+
+/* copyrate, as 100M, 512K or plain bytes per second */
+static uint64_t copy_rate()
+{
+  char *end;
+  double rate = strtod(get_opt_str("copyrate"), &end);
+  switch (toupper(*end)) {
+    case 'G': rate *= 1024; /* fallthrough */
+    case 'M': rate *= 1024; /* fallthrough */
+    case 'K': rate *= 1024;
   }
+  return MAX(rate, 0);
+}
 
-  file.offset += req->result;
-  file.fg->wsize += req->result;
-  file_check_update();
+static void pace_cb(uv_timer_t *);
 
-  if (file.offset < file.len)
-    try_sendfile();
+/* copyrate is a token bucket shared by every copy, holding at most a
+ * quarter second. a step runs while the bucket is in credit and may
+ * leave it owing; the rest wait on the pace timer. */
+static bool xfer_paced(Xfer *x)
+{
+  uint64_t rate = copy_rate();
+  if (rate == 0) {
+    file.filled = 0;
+    return false;
+  }
+
+  /* pacing that just turned on starts with a full bucket */
+  uint64_t now = os_hrtime();
+  if (file.filled)
+    file.tokens += (now - file.filled) / 1e9 * rate;
   else
-    file_close();
+    file.tokens = rate / 4.0;
+  file.tokens = MIN(file.tokens, rate / 4.0);
+  file.filled = now;
+  if (file.tokens > 0) {
+    x->cs.chunk = MIN(x->cs.chunk, MAX(rate / 4, PACE_MIN));
+    return false;
+  }
+
+  TAILQ_INSERT_TAIL(&file.paced, x, ent);
+  if (!uv_is_active((uv_handle_t*)&file.pace))
+    uv_timer_start(&file.pace, pace_cb, 1 - file.tokens * 1000 / rate, 0);
+  return true;
 }
 
-static void open_cb(uv_fs_t *req)
+static void xfer_next(Xfer *);
+
+static void pace_cb(uv_timer_t *handle)
 {
-  log_msg("FILE", "open_cb");
-  if (req->result < 0) {
-    log_err("FILE", "open_cb: |%s|", uv_strerror(req->result));
-    return;
+  struct Paced p = TAILQ_HEAD_INITIALIZER(p);
+  TAILQ_SWAP(&p, &file.paced, Xfer, ent);
+
+  Xfer *x;
+  while ((x = TAILQ_FIRST(&p))) {
+    TAILQ_REMOVE(&p, x, ent);
+    xfer_next(x);
   }
+}
 
-  file.opencnt++;
+/* between copy steps a group may have been paused or cancelled */
+static void xfer_next(Xfer *x)
+{
+  if (fg_cancelled(x->fg)) {
+    x->dropped = true;
+    return file_close(x);
+  }
+  if (x->fg->paused)
+    return xfer_park(x);
+  if (xfer_paced(x))
+    return;
+  try_copy(x);
+}
 
-  if (req == &file.f2) {
-    log_msg("FILE", "OPENED %s", req->path);
-    file.u2 = req->result;
+static void write_cb(WorkReq *req)
+{
+  Xfer *x = req->data;
+  if (x->wret < 0) {
+    log_err("FILE", "write_cb: |%s|", strerror(-x->wret));
+    x->fg->flags |= F_ERROR;
+    return file_close(x);
   }
 
-  if (req == &file.f1) {
-    log_msg("FILE", "OPENED %s", req->path);
-    file.u1 = req->result;
-    file.len = file.s1.st_size;
-    file.blk = MAX(file.s1.st_blksize, 4096);
+  x->offset += x->wret;
+  x->fg->wsize += x->wret;
+  if (file.filled && x->cs.method != COPY_CLONE)
+    file.tokens -= x->wret;
+  file_check_update();
+
+  /* a source that shrank ends early */
+  if (x->offset >= x->len || x->wret == 0)
+    return file_close(x);
+  xfer_next(x);
+}
+
+static void open_cb(uv_fs_t *req)
+{
+  log_msg("FILE", "open_cb");
+  Xfer *x = req->data;
+  x->opening--;
+
+  if (req->result < 0) {
+    log_err("FILE", "open_cb: |%s|", uv_strerror(req->result));
+    x->fg->flags |= F_ERROR;
+    x->err = true;
+  }
+  else {
+    x->opencnt++;
+
+    if (req == &x->f2) {
+      log_msg("FILE", "OPENED %s", req->path);
+      x->u2 = req->result;
+      x->created = true;
+    }
+
+    if (req == &x->f1) {
+      log_msg("FILE", "OPENED %s", req->path);
+      x->u1 = req->result;
+      x->len = x->s1.st_size;
+    }
   }
 
-  if (file.opencnt == 2)
-    try_sendfile();
+  if (x->opening > 0)
+    return;
+  if (x->err || x->len == 0)
+    file_close(x);
+  else
+    xfer_next(x);
 }
 
-static void mk_dest(const char *oldpath, const char *newpath)
+static void mk_dest(Xfer *x, const char *oldpath, const char *newpath)
 {
   log_err("FILE", "mk_dest %s %s", oldpath, newpath);
 
   int ret;
-  if (S_ISDIR(file.s1.st_mode))
+  if (S_ISDIR(x->s1.st_mode))
     ret = rename(oldpath, newpath);
   else
     ret = link(oldpath, newpath);
@@ -292,125 +688,374 @@ static void mk_dest(const char *oldpath, const char *newpath)
   if (ret != 0) {
     log_err("FILE", "%s", strerror(errno));
     if (errno == EXDEV)
-      return file_retry_as_copy();
+      return file_retry_as_copy(x);
 
     log_err("FILE", "unhandled error");
-    file.fg->flags |= F_ERROR;
-    return;
+    x->fg->flags |= F_ERROR;
+    return file_stop(x);
   }
 
-  file.fg->flags |= F_UNLINK;
-  do_unlink(file.cur->src, S_ISDIR(file.s1.st_mode));
-  file_stop();
+  x->fg->flags |= F_UNLINK;
+  do_unlink(x->fg, x->cur->src, S_ISDIR(x->s1.st_mode));
+  file_stop(x);
 }
 
-static void do_copy(const char *src, const char *dst)
+static void do_copy(Xfer *x, const char *src, const char *dst)
 {
   log_err("FILE", "do_copy");
   int r;
-  switch (file.s1.st_mode & S_IFMT) {
+  switch (x->s1.st_mode & S_IFMT) {
     case S_IFDIR:
-      mkdir(dst, file.s1.st_mode);
-      file.fg->wsize += file.s1.st_size;
-      file_stop();
+      mkdir(dst, x->s1.st_mode);
+      x->fg->wsize += x->s1.st_size;
+      file_stop(x);
       break;
     case S_IFLNK:
       r = readlink(src, target, sizeof(target));
-      target[r] = '\0';
+      target[MAX(r, 0)] = '\0';
       symlink(target, dst);
-      file.fg->wsize += file.s1.st_size;
-      file_stop();
+      x->fg->wsize += x->s1.st_size;
+      file_stop(x);
       break;
     case S_IFREG:
-      uv_fs_open(eventloop(), &file.f1, src, O_RDONLY, 0644, open_cb);
-      uv_fs_open(eventloop(), &file.f2, dst, FFRESH,   0644, open_cb);
+      x->opening = 2;
+      uv_fs_open(eventloop(), &x->f1, src, O_RDONLY, 0644, open_cb);
+      uv_fs_open(eventloop(), &x->f2, dst, FFRESH,   0644, open_cb);
       break;
+    default:
+      file_stop(x);
   }
 }
 
-static void get_cur_dest_name(const char *dest)
+static void get_cur_dest_name(Xfer *x, const char *dest)
 {
-  if (BITMASK_CHECK(F_MOVE, file.fg->flags))
+  if (BITMASK_CHECK(F_MOVE, x->fg->flags))
     return;
 
-  if (file.cur->parent)
-    dest = file.cur->parent->dest;
-  SWAP_ALLOC_PTR(file.cur->dest, conspath(dest, basename(file.cur->src)));
+  if (x->cur->parent)
+    dest = x->cur->parent->dest;
+  SWAP_ALLOC_PTR(x->cur->dest, conspath(dest, basename(x->cur->src)));
 }
 
-static void do_stat(const char *path, struct stat *sb)
+static void do_stat(Xfer *x, const char *path, struct stat *sb)
 {
   log_err("FILE", "do_stat");
+  if (fg_cancelled(x->fg)) {
+    x->dropped = true;
+    return file_stop(x);
+  }
 
   int ret = lstat(path, sb);
   if (ret < 0)
     log_err("FILE", "%s", strerror(errno));
 
-  /* file is to be removed */
-  if (BITMASK_CHECK(F_UNLINK, file.fg->flags) && !file.cur->dest)
-    return file_stop();
+  /* file is to be removed. a move retried as copy unlinks once copied */
+  if (BITMASK_CHECK(F_UNLINK, x->fg->flags) &&
+      !BITMASK_CHECK(F_COPY, x->fg->flags))
+    return file_stop(x);
+
+  /* src is gone */
+  if (sb == &x->s1 && ret != 0)
+    return file_stop(x);
 
   /* src exists, check dest */
-  if (sb == &file.s1 && ret == 0) {
-    get_cur_dest_name(file.cur->dest);
-    return do_stat(file.cur->dest, &file.s2);
+  if (sb == &x->s1 && ret == 0) {
+    get_cur_dest_name(x, x->cur->dest);
+    return do_stat(x, x->cur->dest, &x->s2);
   }
 
   /* dest already exists */
-  if (sb == &file.s2 && ret == 0)
-    return find_dest_name();
+  if (sb == &x->s2 && ret == 0)
+    return find_dest_name(x);
 
   /* dest does not exist */
-  if (sb == &file.s2 && errno == ENOENT) {
+  if (sb == &x->s2 && errno == ENOENT) {
 
-    if (BITMASK_CHECK(F_MOVE, file.fg->flags))
-      return mk_dest(file.cur->src, file.cur->dest);
+    if (BITMASK_CHECK(F_MOVE, x->fg->flags))
+      return mk_dest(x, x->cur->src, x->cur->dest);
 
-    do_copy(file.cur->src, file.cur->dest);
+    return do_copy(x, x->cur->src, x->cur->dest);
   }
+
+  x->fg->flags |= F_ERROR;
+  file_stop(x);
+}
+
+static void xfer_start(FileGroup *fg, FileItem *item)
+{
+  Xfer *x = calloc(1, sizeof(Xfer));
+  x->fg = fg;
+  x->cur = item;
+  x->u1 = -1;
+  x->u2 = -1;
+  copy_init(&x->cs);
+  x->w1.data = x;
+  x->f1.data = x;
+  x->f2.data = x;
+  x->c1.data = x;
+  x->c2.data = x;
+  x->m1.data = x;
+
+  fg->active++;
+  file.active++;
+  lane_load(fg->lane, 1);
+  do_stat(x, item->src, &x->s1);
 }
 
 long file_progress()
 {
-  if (TAILQ_EMPTY(&file.p) || file.fg->tsize < 1)
+  if (TAILQ_EMPTY(&file.p))
     return 0;
+  return fg_progress(TAILQ_FIRST(&file.p));
+}
 
-  long long sofar = file.fg->wsize * 100;
-  sofar /= file.fg->tsize;
-  if (sofar > 100)
-    sofar = 100;
-  return sofar;
+/* %j:name, for the oldest running group */
+char* file_job_info(const char *name)
+{
+  FileGroup *fg = TAILQ_FIRST(&file.p);
+  if (!fg || !name)
+    return NULL;
+
+  char *str = NULL;
+  char buf[16];
+  if (!strcmp(name, "rate"))
+    asprintf(&str, "%.0f", fg->rate.bps);
+  else if (!strcmp(name, "fps"))
+    asprintf(&str, "%.1f", fg->rate.fps);
+  else if (!strcmp(name, "eta")) {
+    fmt_eta(fg_eta(fg), buf, sizeof(buf));
+    str = strdup(buf);
+  }
+  else if (!strcmp(name, "percent"))
+    asprintf(&str, "%ld", fg_progress(fg));
+  else if (!strcmp(name, "done"))
+    asprintf(&str, "%" PRIu64, fg->wsize);
+  else if (!strcmp(name, "total"))
+    asprintf(&str, "%" PRIu64, fg_total(fg));
+  else if (!strcmp(name, "files"))
+    asprintf(&str, "%" PRIu64 "/%" PRIu64, fg->files,
+        MAX(fg->tfiles, fg->pfiles));
+  else if (!strcmp(name, "state")) {
+    const char *state = fg_state(fg, os_hrtime());
+    str = strdup(state ? state : "running");
+  }
+  else if (!strcmp(name, "count")) {
+    int count = 0;
+    TAILQ_FOREACH(fg, &file.p, ent)
+      count++;
+    asprintf(&str, "%d", count);
+  }
+  return str;
 }
 
-void file_push(FileGroup *item)
+/* both queues are kept by priority, oldest first within one */
+static void lane_enqueue(FileGroup *fg)
 {
-  TAILQ_INSERT_TAIL(&file.p, item, ent);
-  if (!file.running)
-    file_start();
+  FileGroup *it;
+  TAILQ_FOREACH(it, &fg->lane->p, lent) {
+    if (it->prio < fg->prio)
+      break;
+  }
+  if (it)
+    TAILQ_INSERT_BEFORE(it, fg, lent);
+  else
+    TAILQ_INSERT_TAIL(&fg->lane->p, fg, lent);
 }
 
-void file_start()
+static void fg_enqueue(FileGroup *fg)
 {
-  if (file.running || TAILQ_EMPTY(&file.p))
+  FileGroup *it;
+  TAILQ_FOREACH(it, &file.p, ent) {
+    if (it->prio < fg->prio)
+      break;
+  }
+  if (it)
+    TAILQ_INSERT_BEFORE(it, fg, ent);
+  else
+    TAILQ_INSERT_TAIL(&file.p, fg, ent);
+
+  if (fg->lane)
+    lane_enqueue(fg);
+}
+
+/* a walked group starts once the walker has stat'd its root, which
+ * puts it in a lane. a rename moves no data, so a move is laned at
+ * once on an unknown pair. */
+void file_push(FileGroup *fg)
+{
+  FileItem *item = TAILQ_FIRST(&fg->p);
+  if (!fg->walking)
+    fg->lane = lane_get(0, 0);
+  fg_enqueue(fg);
+
+  fg->id = ++file.ids;
+  if (item->dest)
+    asprintf(&fg->label, "%s -> %s", item->src, item->dest);
+  else
+    fg->label = strdup(item->src);
+  uint64_t now = os_hrtime();
+  fg->rate = (XferRate){ .start = now, .last = now, .moved = now };
+  fg_publish(fg, now);
+
+  if (!uv_is_active((uv_handle_t*)&file.tick))
+    uv_timer_start(&file.tick, file_tick, RATE_SAMPLE, RATE_SAMPLE);
+  file_queue_start();
+}
+
+void file_lane(FileGroup *fg, dev_t src, dev_t dst)
+{
+  if (fg->lane)
     return;
-  if (!file.running)
+  fg->lane = lane_get(src, dst);
+  lane_enqueue(fg);
+}
+
+/* groups in a lane are drained in order, though a later group fills
+ * slots left idle by an earlier one. an item waits for its parent
+ * directory. */
+static FileItem* next_item(FileGroup *fg)
+{
+  FileItem *item = TAILQ_FIRST(&fg->p);
+  if (!item || (item->parent && !item->parent->made))
+    return NULL;
+  TAILQ_REMOVE(&fg->p, item, ent);
+  fg->queued--;
+  return item;
+}
+
+void file_start()
+{
+  file.queued = false;
+  if (file.active == 0)
     file.before = os_hrtime();
 
-  file.running = true;
-  file.fg = TAILQ_FIRST(&file.p);
-  file.cur = TAILQ_FIRST(&file.fg->p);
-  file.offset = 0;
+  FileGroup *fg, *tmp;
+  TAILQ_FOREACH_SAFE(fg, &file.p, ent, tmp) {
+    if (fg_cancelled(fg))
+      fg_drop(fg);
+    if (TAILQ_EMPTY(&fg->p) && fg->active == 0 && !fg->walking &&
+        !fg->sizing) {
+      lane_leave(fg);
+      TAILQ_REMOVE(&file.p, fg, ent);
+      buf_update_progress(fg->owner, fg_progress(fg));
+      buf_update_xfer(fg->owner, "");
+      jobs_remove(fg->id);
+      free(fg->label);
+      free(fg);
+    }
+  }
+  if (TAILQ_EMPTY(&file.p))
+    uv_timer_stop(&file.tick);
+
+  int max = MAX(1, get_opt_uint("copyjobs"));
+  workq_size(file.copyq, max);
+  int devmax = MAX(1, get_opt_uint("devjobs"));
+  Lane *lane;
+
+  /* higher priorities take free slots first; within one, pairs are
+   * served in turn */
+  FileGroup *lvl = TAILQ_FIRST(&file.p);
+  while (lvl) {
+    int prio = lvl->prio;
+    TAILQ_FOREACH(lane, &file.lanes, ent) {
+      TAILQ_FOREACH(fg, &lane->p, lent) {
+        if (fg->prio != prio || fg->paused || fg_cancelled(fg))
+          continue;
+        FileItem *item;
+        while (file.active < max && !lane_full(lane, devmax) &&
+            (item = next_item(fg)))
+          xfer_start(fg, item);
+      }
+    }
+    while (lvl && lvl->prio == prio)
+      lvl = TAILQ_NEXT(lvl, ent);
+  }
 
-  do_stat(file.cur->src, &file.s1);
+  /* the next pass offers free slots to another pair first */
+  if ((lane = TAILQ_FIRST(&file.lanes))) {
+    TAILQ_REMOVE(&file.lanes, lane, ent);
+    TAILQ_INSERT_TAIL(&file.lanes, lane, ent);
+  }
+  ftw_resume();
+}
+
+static FileGroup* fg_find(int id)
+{
+  FileGroup *fg;
+  TAILQ_FOREACH(fg, &file.p, ent) {
+    if (fg->id == id)
+      return fg;
+  }
+  return NULL;
+}
+
+/* copies in flight stop at their next step and remove what they
+ * wrote; files already done are kept */
+static void fg_cancel(FileGroup *fg)
+{
+  if (fg_cancelled(fg))
+    return;
+  log_msg("FILE", "cancel %d", fg->id);
+  __atomic_store_n(&fg->cancel, 1, __ATOMIC_RELAXED);
+  fg->paused = false;
+  ftw_stop(fg);
+  xfer_unpark(fg);
+  fg_publish(fg, os_hrtime());
+  file_queue_start();
+}
+
+bool file_job_cancel(int id)
+{
+  FileGroup *fg = fg_find(id);
+  if (!fg)
+    return false;
+  fg_cancel(fg);
+  return true;
+}
+
+bool file_job_pause(int id, bool pause)
+{
+  FileGroup *fg = fg_find(id);
+  if (!fg || fg_cancelled(fg))
+    return false;
+
+  fg->paused = pause;
+  if (!pause)
+    xfer_unpark(fg);
+  fg_publish(fg, os_hrtime());
+  file_queue_start();
+  return true;
+}
+
+bool file_job_prio(int id, int prio)
+{
+  FileGroup *fg = fg_find(id);
+  if (!fg)
+    return false;
+
+  TAILQ_REMOVE(&file.p, fg, ent);
+  if (fg->lane)
+    TAILQ_REMOVE(&fg->lane->p, fg, lent);
+  fg->prio = prio;
+  fg_enqueue(fg);
+  fg_publish(fg, os_hrtime());
+  file_queue_start();
+  return true;
+}
+
+int file_job_first()
+{
+  FileGroup *fg = TAILQ_FIRST(&file.p);
+  return fg ? fg->id : 0;
 }
 
 void file_cancel(Buffer *owner)
 {
-  //TODO:
-  //search for owner in queue
-  //cancel matches
-  //  F_COPY: unlink dest if opened
-  ftw_cancel();
+  FileGroup *fg, *tmp;
+  TAILQ_FOREACH_SAFE(fg, &file.p, ent, tmp) {
+    if (fg->owner == owner)
+      fg_cancel(fg);
+  }
 }
 
 void file_move_str(char *src, char *dest, Buffer *owner)
@@ -435,8 +1080,28 @@ void file_copy(varg_T args, char *dest, Buffer *owner)
     ftw_add(args.argv[i], dest, fg_new(owner, F_COPY));
 }
 
+/* on the loop once the walker tried the trash. expired entries are
+ * purged in the background the first time a trash is used in a session.
+ * a path that could not be trashed is left in place, never unlinked. */
+void file_trashed(char *src, char *dir, int err)
+{
+  if (!dir) {
+    nv_err("trash: %s: %s, left in place", src, strerror(err));
+    return;
+  }
+
+  uint days = get_opt_uint("trashdays");
+  if (days > 0 && trash_first(dir))
+    ftw_purge(dir, time(NULL) - days * 86400);
+}
+
 void file_remove(varg_T args, Buffer *owner)
 {
-  for (int i = 0; i < args.argc; i++)
-    ftw_add(args.argv[i], NULL, fg_new(owner, F_UNLINK));
+  bool trash = !strcmp(get_opt_str("deletemode"), "trash");
+  for (int i = 0; i < args.argc; i++) {
+    if (trash)
+      ftw_trash(args.argv[i]);
+    else
+      ftw_add(args.argv[i], NULL, fg_new(owner, F_UNLINK));
+  }
 }
@@ -4,6 +4,7 @@
 #include <uv.h>
 #include "nav/lib/sys_queue.h"
 #include "nav/plugins/plugin.h"
+#include "nav/event/ioprio.h"
 
 #define F_COPY       1
 #define F_MOVE       2
@@ -19,16 +20,47 @@ struct FileItem {
   char *dest;
   FileItem *parent;
   int refs;
+  bool made;       //done, children may start
+  bool dropped;    //cancelled before it ran, src is kept
 };
 
+/* sampled while a group runs */
+typedef struct {
+  uint64_t start;  //hrtime pushed
+  uint64_t last;   //hrtime of the last sample
+  uint64_t moved;  //hrtime progress was last seen
+  uint64_t wlast;  //wsize at the last sample
+  uint64_t flast;  //files at the last sample
+  double bps;      //bytes per second, EWMA
+  double fps;      //files per second, EWMA
+} XferRate;
+
+typedef struct Lane Lane;
 typedef struct FileGroup FileGroup;
 struct FileGroup {
   TAILQ_HEAD(cont, FileItem) p;
   TAILQ_ENTRY(FileGroup) ent;
+  TAILQ_ENTRY(FileGroup) lent;
+  Lane *lane;      //source and dest device pair
   Buffer *owner;
   int flags;       //F_MOVE, F_COPY etc
-  uint64_t tsize;  //size to write
+  int active;      //items in flight
+  int queued;      //items in p
+  bool walking;    //items still arriving from the walker
+  bool sizing;     //pre-flight total in flight
+  int id;          //listed in :jobs
+  int prio;        //higher groups take free slots first
+  bool paused;     //no new items; copies park between steps
+  int cancel;      //read by the pre-flight thread
+  JobPrio io;      //applied by threads working for the group
+  char *label;
+  uint64_t tsize;  //size to write, as walked
   uint64_t wsize;  //size written
+  uint64_t total;  //pre-flight size
+  uint64_t tfiles; //entries walked
+  uint64_t pfiles; //pre-flight entries
+  uint64_t files;  //entries done
+  XferRate rate;
 };
 
 void file_init();
@@ -38,8 +70,16 @@ void file_copy(varg_T, char *dest, Buffer *);
 void file_move(varg_T, char *dest, Buffer *);
 void file_remove(varg_T, Buffer *);
 void file_push(FileGroup *fg);
+void file_lane(FileGroup *fg, dev_t src, dev_t dst);
+void file_release(FileGroup *fg, FileItem *item, bool isdir);
+void file_trashed(char *src, char *dir, int err);
 void file_start();
 void file_cancel(Buffer *);
 long file_progress();
+bool file_job_pause(int id, bool pause);
+bool file_job_cancel(int id);
+bool file_job_prio(int id, int prio);
+int file_job_first();
+char* file_job_info(const char *name);
 
 #endif
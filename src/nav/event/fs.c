@@ -1,6 +1,13 @@
 #include <time.h>
 #include <libgen.h>
 #include <wordexp.h>
+#include <fnmatch.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 #include "nav/event/fs.h"
 #include "nav/model.h"
@@ -8,33 +15,106 @@
 #include "nav/log.h"
 #include "nav/table.h"
 #include "nav/info.h"
+#include "nav/option.h"
+#include "nav/event/uring.h"
+#include "nav/event/dcache.h"
+#include "nav/util.h"
 
 static void fs_close_req(fentry *);
 static void fs_reopen(fentry *);
 static void stat_cb(uv_fs_t *);
 static void fs_flush_stream(fentry *);
 static void watch_cb(uv_fs_event_t *, const char *, int, int);
+static void delta_drop(fentry *);
+static void watch_settle(fentry *);
+static void read_detach(FsRead *);
 
 #define MAX_WAIT 1000
+#define SCAN_BATCH 256  /* entries stat'd per worker request */
+#define DELTA_WAIT 10   /* ms to coalesce watcher events */
+#define CHURN_RATE 20   /* events/s past which updates back off */
+#define HEAT_HALF 500   /* ms half-life of the event rate */
+#define SETTLE_WAIT 250 /* ms of quiet that closes a backed off window */
+#define BACKOFF_MAX 16000
+#define BACKOFF_STEPS 11
+#define PREFETCH_MAX 2    /* prefetch scans in flight */
+#define PREFETCH_WAIT 150 /* ms the cursor rests before prefetching */
+#define DCACHE_MIN 100    /* smaller listings rescan quickly enough */
+#define DCACHE_MAX 200000 /* entries saved across all listings */
+#define DCACHE_AGE (30 * 86400) /* s; listings unused longer are dropped */
+#define READ_WAIT 5000    /* ms before a path resolve is given up */
+#define READ_MAX 4        /* resolve threads, stuck ones included */
+#define STREAM_CHUNK 5000 /* records committed before a partial listing */
+#define STREAM_WAIT 16    /* ms between partial listings once shown */
+
+enum watch_policy {
+  WATCH_ADAPTIVE,   //back off updates under churn
+  WATCH_FIXED,      //coalesce for a fixed window
+  WATCH_OFF,        //count events, never update
+};
+
+static const char *policy_names[] = {
+  [WATCH_ADAPTIVE] = "adaptive",
+  [WATCH_FIXED]    = "fixed",
+  [WATCH_OFF]      = "off",
+};
+
+typedef struct {
+  uv_work_t req;
+  fentry *ent;
+  char *dir;
+  bool lazy;        //records already committed with d_type only
+  int flags;        //statx sync flags
+  int count;
+  char *names[SCAN_BATCH];
+  char *paths[SCAN_BATCH];
+  struct stat st[SCAN_BATCH];
+  bool err[SCAN_BATCH];
+} ScanBatch;
 
 struct fentry {
   char *key;
   uv_fs_event_t watcher;
   uv_fs_t uv_fs;
   uv_timer_t watcher_timer;
+  uv_timer_t delta_timer;
+  ScanBatch *delta; //names reported by the watcher
+  int policy;
+  int backoff;      //window shift while churning
+  int burst;        //events since the last update
+  uint heat;        //decaying event count, ~events/s
+  uint64_t last_event;
+  uint64_t deadline;
+  uint events;      //watcher events received
+  uint suppressed;  //events folded into another update
   bool running;
   bool flush;
   bool cancel;
   bool reopen;
+  bool retype;      //lazy stat changed an entry's type
+  bool reading;     //readdir chunks outstanding
+  bool lazy;        //this scan commits before stat
+  int scanflags;
+  uv_dir_t *scandir;
+  uv_dirent_t *dents;
+  DirKey scankey;   //stat of the directory being scanned
+  int committed;    //records committed this scan
+  int published;    //records at the last partial listing
+  uint64_t pubtime;
   uint64_t before;
   int refs;
+  int pending;      //stat batches in flight
+  bool closing;     //signal listeners once pending drains
+  bool prefetch;    //scanned ahead of any listener
+  bool warm;        //drawn from the disk cache, not yet revalidated
+  bool released;    //handles closed, out of ent_tbl
   nv_fs *listeners;
   UT_hash_handle hh;
 };
 
 typedef struct {
   char *key;
-  time_t ctimesec;
+  DirKey dk;
   UT_hash_handle hh;
 } cachedir;
 
@@ -42,21 +122,33 @@ static fentry   *ent_tbl;
 static cachedir *cache_tbl;
 static char *g_curdir;
 
+static uv_timer_t prefetch_timer;
+static bool prefetch_init;
+static char *prefetch_want[2];
+static int prefetch_count;
+
+static fentry* ent_new(const char *path)
+{
+  fentry *ent = calloc(1, sizeof(fentry));
+  ent->key = strdup(path);
+  ent->refs = 3;
+  uv_fs_event_init(eventloop(), &ent->watcher);
+  uv_timer_init(eventloop(), &ent->watcher_timer);
+  uv_timer_init(eventloop(), &ent->delta_timer);
+  ent->watcher.data = ent;
+  ent->watcher_timer.data = ent;
+  ent->delta_timer.data = ent;
+  ent->uv_fs.data = ent;
+  HASH_ADD_STR(ent_tbl, key, ent);
+  return ent;
+}
+
 static fentry* fs_mux(nv_fs *fs)
 {
   fentry *ent = NULL;
   HASH_FIND_STR(ent_tbl, fs->path, ent);
-  if (!ent) {
-    ent = calloc(1, sizeof(fentry));
-    ent->key = strdup(fs->path);
-    ent->refs = 2;
-    uv_fs_event_init(eventloop(), &ent->watcher);
-    uv_timer_init(eventloop(), &ent->watcher_timer);
-    ent->watcher.data = ent;
-    ent->watcher_timer.data = ent;
-    ent->uv_fs.data = ent;
-    HASH_ADD_STR(ent_tbl, key, ent);
-  }
+  if (!ent)
+    ent = ent_new(fs->path);
 
   nv_fs *find = NULL;
   HASH_FIND_PTR(ent->listeners, fs->path, find);
@@ -67,9 +159,8 @@ static fentry* fs_mux(nv_fs *fs)
   return ent;
 }
 
-static void del_ent(uv_handle_t *hndl)
+static void ent_unref(fentry *ent)
 {
-  fentry *ent = hndl->data;
   ent->refs--;
   if (ent->refs < 1) {
     free(ent->key);
@@ -77,6 +168,29 @@ static void del_ent(uv_handle_t *hndl)
   }
 }
 
+static void del_ent(uv_handle_t *hndl)
+{
+  ent_unref(hndl->data);
+}
+
+static void ent_release(fentry *ent)
+{
+  if (ent->released)
+    return;
+  ent->released = true;
+  HASH_DEL(ent_tbl, ent);
+  uv_timer_stop(&ent->watcher_timer);
+  uv_fs_event_stop(&ent->watcher);
+  uv_fs_req_cleanup(&ent->uv_fs);
+  delta_drop(ent);
+  uv_handle_t *hw = (uv_handle_t*)&ent->watcher;
+  uv_handle_t *ht = (uv_handle_t*)&ent->watcher_timer;
+  uv_handle_t *hd = (uv_handle_t*)&ent->delta_timer;
+  uv_close(hw, del_ent);
+  uv_close(ht, del_ent);
+  uv_close(hd, del_ent);
+}
+
 static void fs_demux(nv_fs *fs)
 {
   log_msg("FS", "fs_demux");
@@ -86,16 +200,9 @@ static void fs_demux(nv_fs *fs)
 
   HASH_DEL(ent->listeners, fs);
 
-  if (HASH_COUNT(ent->listeners) < 1) {
-    HASH_DEL(ent_tbl, ent);
-    uv_timer_stop(&ent->watcher_timer);
-    uv_fs_event_stop(&ent->watcher);
-    uv_fs_req_cleanup(&ent->uv_fs);
-    uv_handle_t *hw = (uv_handle_t*)&ent->watcher;
-    uv_handle_t *ht = (uv_handle_t*)&ent->watcher_timer;
-    uv_close(hw, del_ent);
-    uv_close(ht, del_ent);
-  }
+  /* a running scan is released when it finishes */
+  if (HASH_COUNT(ent->listeners) < 1 && !ent->prefetch && !ent->running)
+    ent_release(ent);
 
   free(fs->path);
   fs->ent = NULL;
@@ -113,6 +220,8 @@ nv_fs* fs_init(Handle *hndl)
 void fs_cleanup(nv_fs *fs)
 {
   log_msg("FS", "cleanup");
+  if (fs->read)
+    read_detach(fs->read);
   fs_close(fs);
   free(fs);
 }
@@ -122,7 +231,7 @@ void fs_clr_cache(char *path)
   cachedir *cache;
   HASH_FIND_STR(cache_tbl, path, cache);
   if (cache)
-    cache->ctimesec = -1;
+    cache->dk.ctime.tv_sec = -1;
 }
 
 void fs_clr_all_cache()
@@ -135,6 +244,37 @@ void fs_clr_all_cache()
   }
 }
 
+static DirKey dir_key(uv_stat_t *st)
+{
+  return (DirKey){
+    .dev   = st->st_dev,
+    .ino   = st->st_ino,
+    .mtime = {st->st_mtim.tv_sec, st->st_mtim.tv_nsec},
+    .ctime = {st->st_ctim.tv_sec, st->st_ctim.tv_nsec},
+  };
+}
+
+static bool dir_key_eq(DirKey *a, DirKey *b)
+{
+  return a->dev == b->dev && a->ino == b->ino &&
+    a->mtime.tv_sec == b->mtime.tv_sec &&
+    a->mtime.tv_nsec == b->mtime.tv_nsec &&
+    a->ctime.tv_sec == b->ctime.tv_sec &&
+    a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+static void add_dir(const char *path, DirKey *dk)
+{
+  cachedir *cache;
+  HASH_FIND_STR(cache_tbl, path, cache);
+  if (!cache) {
+    cache = malloc(sizeof(cachedir));
+    cache->key = strdup(path);
+    HASH_ADD_STR(cache_tbl, key, cache);
+  }
+  cache->dk = *dk;
+}
+
 char* conspath(const char *str1, const char *str2)
 {
   char *result;
@@ -197,31 +337,187 @@ char* fs_trypath(char *path)
   return dir;
 }
 
-static void stat_cleanup(void **args)
+/* resolution may hang on a dead mount, so it runs on a detached thread of
+ * its own rather than holding a pool worker. once detached, by timeout or
+ * a newer request, the result is dropped and the request is freed when the
+ * thread reports back. stuck threads count against READ_MAX. */
+struct FsRead {
+  TAILQ_ENTRY(FsRead) ent;
+  uv_timer_t timer;
+  nv_fs *fs;        //NULL once detached
+  char *want;       //as requested
+  char *tries[2];   //expanded candidates, read by the thread
+  char *path;       //resolved, owned by the thread until done
+  struct stat st;
+  int err;
+  bool timedout;
+  bool done;        //result queued
+  int refs;         //thread, timer, queued result
+};
+
+static struct {
+  uv_async_t async;
+  uv_mutex_t lock;
+  TAILQ_HEAD(Reads, FsRead) done;
+  int live;         //threads not yet reported back
+  bool init;
+} reads;
+
+static void read_free(FsRead *r)
+{
+  if (--r->refs > 0)
+    return;
+  free(r->want);
+  for (int i = 0; i < LENGTH(r->tries); i++)
+    free(r->tries[i]);
+  free(r->path);
+  free(r);
+}
+
+static void read_timer_close(uv_handle_t *hndl)
 {
-  nv_fs *fs = args[0];
-  free(args[1]);
-  free(fs->readkey);
-  uv_fs_req_cleanup(&fs->uv_fs);
-  fs->running = false;
+  read_free(hndl->data);
 }
 
-static void stat_read_cb(uv_fs_t *req)
+static void read_detach(FsRead *r)
 {
-  log_msg("FS", "stat_read_cb");
-  nv_fs *fs = req->data;
-  if (req->result < 0) {
-    log_err("FILE", "stat_read_cb: |%s|", uv_strerror(req->result));
-    CREATE_EVENT(eventq(), fs->stat_cb, 3, fs->data, fs->readkey, 0);
-    CREATE_EVENT(eventq(), stat_cleanup, 2, fs, NULL);
+  if (r->fs)
+    r->fs->read = NULL;
+  r->fs = NULL;
+  if (!uv_is_closing((uv_handle_t*)&r->timer))
+    uv_close((uv_handle_t*)&r->timer, read_timer_close);
+}
+
+static void read_done(void **args)
+{
+  FsRead *r = args[0];
+  nv_fs *fs = r->fs;
+  if (fs) {
+    read_detach(r);
+    if (r->timedout || r->err)
+      fs->stat_cb((void*[]){fs->data, r->want, NULL});
+    else
+      fs->stat_cb((void*[]){fs->data, r->path, &r->st});
+  }
+  read_free(r);
+}
+
+static void read_deliver(FsRead *r)
+{
+  if (r->done || !r->fs)
     return;
+  r->done = true;
+  r->refs++;
+  CREATE_EVENT(eventq(), read_done, 1, r);
+}
+
+static void* read_thread(void *arg)
+{
+  FsRead *r = arg;
+  for (int i = 0; i < LENGTH(r->tries) && !r->path; i++)
+    r->path = realpath(r->tries[i], NULL);
+
+  if (!r->path)
+    r->err = errno;
+  else if (stat(r->path, &r->st) == -1)
+    r->err = errno;
+
+  uv_mutex_lock(&reads.lock);
+  TAILQ_INSERT_TAIL(&reads.done, r, ent);
+  uv_mutex_unlock(&reads.lock);
+  uv_async_send(&reads.async);
+  return NULL;
+}
+
+static void read_drain(uv_async_t *hndl)
+{
+  struct Reads done = TAILQ_HEAD_INITIALIZER(done);
+  uv_mutex_lock(&reads.lock);
+  TAILQ_CONCAT(&done, &reads.done, ent);
+  uv_mutex_unlock(&reads.lock);
+
+  FsRead *r;
+  while ((r = TAILQ_FIRST(&done))) {
+    TAILQ_REMOVE(&done, r, ent);
+    reads.live--;
+    read_deliver(r);
+    read_free(r);
   }
+}
 
-  char *path = realpath(fs->readkey, NULL);
-  log_msg("FS", "req_stat_cb %s", req->path);
+static bool read_spawn(FsRead *r)
+{
+  if (!reads.init) {
+    TAILQ_INIT(&reads.done);
+    uv_mutex_init(&reads.lock);
+    uv_async_init(eventloop(), &reads.async, read_drain);
+    uv_unref((uv_handle_t*)&reads.async);
+    reads.init = true;
+  }
+  if (reads.live >= READ_MAX)
+    return false;
+
+  pthread_t tid;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int err = pthread_create(&tid, &attr, read_thread, r);
+  pthread_attr_destroy(&attr);
+  if (err)
+    return false;
+  reads.live++;
+  return true;
+}
 
-  CREATE_EVENT(eventq(), fs->stat_cb, 3, fs->data, path, &req->statbuf);
-  CREATE_EVENT(eventq(), stat_cleanup, 2, fs, path);
+static void read_timer_cb(uv_timer_t *hndl)
+{
+  FsRead *r = hndl->data;
+  log_err("FS", "resolve timed out: %s", r->want);
+  r->timedout = true;
+  read_deliver(r);
+}
+
+/* the quoted form keeps spaces literal; the bare form expands ~.
+ * wordexp runs here on the loop; the thread only does realpath/stat. */
+void fs_read(nv_fs *fs, const char *dir)
+{
+  log_msg("FS", "fs read %s", dir);
+  if (fs->read)
+    read_detach(fs->read);
+
+  FsRead *r = calloc(1, sizeof(FsRead));
+  r->fs = fs;
+  r->want = strdup(dir);
+  r->refs = 1;
+  r->timer.data = r;
+  fs->read = r;
+
+  if (dir[0] == '@') {
+    char *mark = mark_path(dir);
+    if (mark)
+      SWAP_ALLOC_PTR(r->want, strdup(mark));
+  }
+
+  char *quoted = add_quotes(r->want);
+  char *forms[] = {quoted, r->want};
+  for (int i = 0; i < LENGTH(forms); i++) {
+    char *path = fs_expand_path(forms[i]);
+    if (path[0] != '/')
+      SWAP_ALLOC_PTR(path, conspath(g_curdir, path));
+    r->tries[i] = path;
+  }
+  free(quoted);
+
+  uv_timer_init(eventloop(), &r->timer);
+  r->refs++;
+  if (!read_spawn(r)) {
+    r->refs--;
+    log_err("FS", "resolve not started: %s", r->want);
+    r->err = EAGAIN;
+    read_deliver(r);
+    return;
+  }
+  uv_timer_start(&r->timer, read_timer_cb, READ_WAIT, 0);
 }
 
 const char* file_ext(const char *filename)
@@ -299,12 +595,32 @@ void fs_signal_handle(void **data)
 {
   log_msg("FS", "fs_signal_handle");
   fentry *ent = data[0];
+  bool cancel = ent->cancel;
   if (ent->cancel) {
+    ent->reopen |= ent->warm;
+    ent->warm = false;
     fs_flush_stream(ent);
     tbl_del_val("fm_files", "dir", ent->key);
     fs_clr_cache(ent->key);
+    ent->cancel = false;
+  }
+
+  if (ent->prefetch) {
+    ent->prefetch = false;
+    prefetch_count--;
+    ent->running = false;
+
+    if (HASH_COUNT(ent->listeners) < 1)
+      ent_release(ent);
+    /* opened while a cancelled prefetch drained */
+    else if (cancel)
+      fs_reopen(ent);
+    else
+      goto notify;
+    return ent_unref(ent);
   }
 
+notify:;
   nv_fs *it = NULL;
   for (it = ent->listeners; it != NULL; it = it->hh.next) {
     Handle *h = it->hndl;
@@ -317,6 +633,9 @@ void fs_signal_handle(void **data)
   ent->running = false;
   ent->flush = false;
   ent->reopen = false;
+  if (HASH_COUNT(ent->listeners) < 1)
+    ent_release(ent);
+  ent_unref(ent);
 }
 
 bool fs_blocking(nv_fs *fs)
@@ -324,15 +643,176 @@ bool fs_blocking(nv_fs *fs)
   return fs->ent ? fs->ent->running : false;
 }
 
-void fs_read(nv_fs *fs, const char *dir)
+static char* dcache_file()
 {
-  log_msg("FS", "fs read %s", dir);
-  if (fs->running)
+  char *opt = get_opt_str("dircache");
+  return opt && opt[0] ? fs_expand_path(opt) : NULL;
+}
+
+static void dcache_commit(void *arg, const char *name, struct stat *st)
+{
+  const char *dir = arg;
+  char *path = conspath(dir, name);
+  trans_rec *r = mk_trans_rec(tbl_fld_count("fm_files"));
+  edit_trans(r, "name",     (char*)name, NULL);
+  edit_trans(r, "dir",      (char*)dir,  NULL);
+  edit_trans(r, "fullpath", path,        NULL);
+
+  struct stat *cstat = malloc(sizeof(struct stat));
+  *cstat = *st;
+  edit_trans(r, "stat",     NULL,        cstat);
+  commit((void*[]){"fm_files", r});
+  free(path);
+}
+
+static void dcache_recv(void **args)
+{
+  fentry *ent = args[0];
+  if (ent->warm && !ent->released) {
+    nv_fs *it = NULL;
+    for (it = ent->listeners; it != NULL; it = it->hh.next) {
+      if (!it->open_cb && it->hndl->model)
+        model_recv(it->hndl->model);
+    }
+  }
+  ent_unref(ent);
+}
+
+/* a directory not seen this session is drawn from the disk cache while
+ * the stat that follows decides whether it must be rescanned. */
+static void dcache_load(fentry *ent)
+{
+  cachedir *cache;
+  HASH_FIND_STR(cache_tbl, ent->key, cache);
+  if (cache)
     return;
-  fs->running = true;
-  fs->uv_fs.data = fs;
-  fs->readkey = strdup(dir);
-  uv_fs_stat(eventloop(), &fs->uv_fs, fs->readkey, stat_read_cb);
+
+  char *file = dcache_file();
+  if (!file)
+    return;
+  dcache_open(file);
+  free(file);
+
+  DirKey dk;
+  if (!dcache_read(ent->key, &dk, NULL, NULL))
+    return;
+
+  log_msg("FS", "dcache hit %s", ent->key);
+  tbl_del_val("fm_files", "dir", ent->key);
+  dcache_read(ent->key, &dk, dcache_commit, ent->key);
+  add_dir(ent->key, &dk);
+  ent->warm = true;
+  ent->refs++;
+  CREATE_EVENT(eventq(), dcache_recv, 1, ent);
+}
+
+static bool dcache_seen(const char *dir)
+{
+  cachedir *cache;
+  HASH_FIND_STR(cache_tbl, dir, cache);
+  return cache;
+}
+
+/* listings read this session replace those on disk. older ones fill
+ * what is left of DCACHE_MAX, most recently used first. */
+void fs_cache_save()
+{
+  char *file = dcache_file();
+  if (!file)
+    return;
+  dcache_open(file);
+
+  DcWriter *w = dcache_begin(file);
+  free(file);
+  if (!w)
+    return;
+
+  int total = 0;
+  cachedir *it, *tmp;
+  HASH_ITER(hh, cache_tbl, it, tmp) {
+    Ventry *head = fnd_val("fm_files", "dir", it->key);
+    int count = head ? tbl_ent_count(head) : 0;
+    if (count < DCACHE_MIN || it->dk.ctime.tv_sec == -1)
+      continue;
+    if (total + count > DCACHE_MAX)
+      continue;
+    total += count;
+
+    dcache_dir(w, it->key, &it->dk, count);
+    Ventry *ent = head;
+    for (int i = 0; i < count; i++) {
+      TblRec *rec = ent->rec;
+      dcache_ent(w, rec_fld(rec, "name"), rec_fld(rec, "stat"));
+      ent = ent->next;
+    }
+  }
+  dcache_keep(w, dcache_seen, DCACHE_MAX - total, time(NULL) - DCACHE_AGE);
+  dcache_end(w);
+  dcache_close();
+}
+
+/* watchpolicy is a comma separated list of policies, optionally as
+ * pattern:policy. the first matching pattern wins over a bare policy.
+ * the list is parsed and its patterns expanded only when the option
+ * changes. */
+typedef struct {
+  char *pat;      //expanded, NULL for a bare policy
+  int policy;     //-1 when unknown
+} PolicyRule;
+
+static struct {
+  char *src;      //option value the rules came from
+  PolicyRule *rules;
+  int count;
+} policies;
+
+static void policy_parse(const char *opt)
+{
+  for (int i = 0; i < policies.count; i++)
+    free(policies.rules[i].pat);
+  free(policies.rules);
+  policies.rules = NULL;
+  policies.count = 0;
+  SWAP_ALLOC_PTR(policies.src, strdup(opt));
+
+  char *str = strdup(opt);
+  char *save;
+  for (char *tok = strtok_r(str, ",", &save); tok;
+      tok = strtok_r(NULL, ",", &save)) {
+    PolicyRule rule = {NULL, -1};
+    char *name = strrchr(tok, ':');
+    if (name) {
+      *name++ = '\0';
+      rule.pat = fs_expand_path(tok);
+    }
+    for (int i = 0; i < LENGTH(policy_names); i++) {
+      if (!strcmp(name ? name : tok, policy_names[i]))
+        rule.policy = i;
+    }
+    policies.rules = realloc(policies.rules,
+        (policies.count + 1) * sizeof(PolicyRule));
+    policies.rules[policies.count++] = rule;
+  }
+  free(str);
+}
+
+static int watch_policy(const char *path)
+{
+  const char *opt = get_opt_str("watchpolicy");
+  if (!policies.src || strcmp(opt, policies.src))
+    policy_parse(opt);
+
+  int policy = WATCH_ADAPTIVE;
+  for (int i = 0; i < policies.count; i++) {
+    PolicyRule *rule = &policies.rules[i];
+    if (rule->pat && fnmatch(rule->pat, path, 0))
+      continue;
+    if (rule->policy != -1)
+      policy = rule->policy;
+    if (rule->pat)
+      break;
+  }
+  return policy;
 }
 
 void fs_open(nv_fs *fs, const char *dir)
@@ -340,46 +820,90 @@ void fs_open(nv_fs *fs, const char *dir)
   log_msg("FS", "fs open %s", dir);
   fs->path = strdup(dir);
   fentry *ent = fs_mux(fs);
+  ent->policy = watch_policy(ent->key);
 
   if (!ent->running) {
     ent->running = true;
-
+    dcache_load(ent);
     uv_fs_stat(eventloop(), &ent->uv_fs, ent->key, stat_cb);
-    uv_fs_event_start(&ent->watcher, watch_cb, ent->key, 1);
   }
+  /* prefetched entries are not watched until opened */
+  if (!uv_is_active((uv_handle_t*)&ent->watcher))
+    uv_fs_event_start(&ent->watcher, watch_cb, ent->key, 1);
 }
 
-void fs_close(nv_fs *fs)
+static void prefetch_start(const char *path)
 {
-  fs_demux(fs);
+  fentry *ent = NULL;
+  HASH_FIND_STR(ent_tbl, path, ent);
+  if (ent)
+    return;
+
+  log_msg("FS", "prefetch %s", path);
+  ent = ent_new(path);
+  ent->policy = watch_policy(ent->key);
+  ent->prefetch = true;
+  ent->running = true;
+  prefetch_count++;
+  uv_fs_stat(eventloop(), &ent->uv_fs, ent->key, stat_cb);
 }
 
-static int edit_trans_stat(trans_rec *r, const char *path, int upd)
+static void prefetch_timer_cb(uv_timer_t *handle)
 {
-  struct stat s;
-  if (lstat(path, &s) == -1)
-    return 1;
+  for (int i = 0; i < LENGTH(prefetch_want); i++) {
+    if (prefetch_want[i] && prefetch_count < PREFETCH_MAX)
+      prefetch_start(prefetch_want[i]);
+    free(prefetch_want[i]);
+    prefetch_want[i] = NULL;
+  }
+}
 
-  struct stat *cstat = malloc(sizeof(struct stat));
-  *cstat = s;
-  edit_trans(r, "stat",     NULL,        cstat);
-  return 0;
+static bool prefetch_wanted(const char *path)
+{
+  for (int i = 0; i < LENGTH(prefetch_want); i++) {
+    if (prefetch_want[i] && !strcmp(prefetch_want[i], path))
+      return true;
+  }
+  return false;
 }
 
-static void add_dir(const char *path, uv_stat_t stat)
+/* scan the hovered child and the parent into the table once the cursor
+ * rests. prefetches no longer wanted are cancelled. */
+void fs_prefetch(const char *child, const char *parent)
 {
-  cachedir *cache;
-  HASH_FIND_STR(cache_tbl, path, cache);
-  if (!cache) {
-    cache = malloc(sizeof(cachedir));
-    cache->key = strdup(path);
-    HASH_ADD_STR(cache_tbl, key, cache);
+  if (!prefetch_init) {
+    uv_timer_init(eventloop(), &prefetch_timer);
+    prefetch_init = true;
   }
-  cache->ctimesec = stat.st_ctim.tv_sec;
+
+  const char *want[] = {child, parent};
+  for (int i = 0; i < LENGTH(prefetch_want); i++) {
+    free(prefetch_want[i]);
+    prefetch_want[i] = want[i] ? strdup(want[i]) : NULL;
+  }
+
+  fentry *it, *tmp;
+  HASH_ITER(hh, ent_tbl, it, tmp) {
+    if (it->prefetch && HASH_COUNT(it->listeners) < 1 && !it->cancel &&
+        !prefetch_wanted(it->key)) {
+      it->cancel = true;
+      uv_cancel((uv_req_t*)&it->uv_fs);
+    }
+  }
+  uv_timer_start(&prefetch_timer, prefetch_timer_cb, PREFETCH_WAIT, 0);
+}
+
+void fs_close(nv_fs *fs)
+{
+  fs_demux(fs);
 }
 
 void fs_cancel(nv_fs *fs)
 {
+  if (fs->read)
+    read_detach(fs->read);
+  if (!fs->ent)
+    return;
   fs->ent->cancel = true;
   uv_cancel((uv_req_t*)&fs->ent->uv_fs);
 }
@@ -393,38 +917,342 @@ static void fs_flush_stream(fentry *ent)
   }
 }
 
-static void scan_cb(uv_fs_t *req)
+static ScanBatch* batch_new(fentry *ent, bool lazy, int flags)
 {
-  log_msg("FS", "--scan--");
-  log_msg("FS", "path: %s", req->path);
-  uv_dirent_t dent;
-  fentry *ent = req->data;
+  ScanBatch *batch = malloc(sizeof(ScanBatch));
+  batch->req.data = batch;
+  batch->ent = ent;
+  batch->dir = strdup(ent->key);
+  batch->lazy = lazy;
+  batch->flags = flags;
+  batch->count = 0;
+  return batch;
+}
+
+static void batch_free(ScanBatch *batch)
+{
+  for (int i = 0; i < batch->count; i++) {
+    free(batch->names[i]);
+    free(batch->paths[i]);
+  }
+  free(batch->dir);
+  free(batch);
+}
 
+static void commit_entry(ScanBatch *batch, int i)
+{
+  trans_rec *r = mk_trans_rec(tbl_fld_count("fm_files"));
+  edit_trans(r, "name",     batch->names[i], NULL);
+  edit_trans(r, "dir",      batch->dir,      NULL);
+  edit_trans(r, "fullpath", batch->paths[i], NULL);
+
+  struct stat *cstat = malloc(sizeof(struct stat));
+  *cstat = batch->st[i];
+  edit_trans(r, "stat",     NULL,            cstat);
+  commit((void*[]){"fm_files", r});
+}
+
+/* listings too long to wait for are shown in chunks while the scan runs.
+ * the first waits for a full chunk so short scans are only drawn sorted. */
+static void scan_publish(fentry *ent, int count)
+{
+  ent->committed += count;
+  uint64_t now = os_hrtime();
+  bool due = ent->committed - ent->published >= STREAM_CHUNK ||
+    (ent->published > 0 && (now - ent->pubtime)/1000000 >= STREAM_WAIT);
+  if (!due || ent->committed == ent->published)
+    return;
+
+  ent->published = ent->committed;
+  ent->pubtime = now;
+  nv_fs *it = NULL;
+  for (it = ent->listeners; it != NULL; it = it->hh.next) {
+    if (!it->open_cb && it->hndl->model)
+      model_stream(it->hndl->model);
+  }
+}
+
+static void commit_batch(void **args)
+{
+  ScanBatch *batch = args[0];
+  fentry *ent = batch->ent;
+  int count = 0;
+  for (int i = 0; i < batch->count; i++) {
+    if (!batch->err[i]) {
+      commit_entry(batch, i);
+      count++;
+    }
+  }
+  if (!ent->released && !ent->cancel)
+    scan_publish(ent, count);
+  batch_free(batch);
+  ent_unref(ent);
+}
+
+/* overwrite the d_type placeholder of committed records. entries that
+ * vanished keep it until the watcher rescans. */
+static void fill_batch(ScanBatch *batch)
+{
+  for (int i = 0; i < batch->count; i++) {
+    if (batch->err[i])
+      continue;
+    Ventry *it = fnd_val("fm_files", "fullpath", batch->paths[i]);
+    if (!it)
+      continue;
+
+    struct stat *st = rec_fld(it->rec, "stat");
+    if ((st->st_mode & S_IFMT) != (batch->st[i].st_mode & S_IFMT))
+      batch->ent->retype = true;
+    *st = batch->st[i];
+  }
+}
+
+static void fill_done(fentry *ent)
+{
+  nv_fs *it = NULL;
+  for (it = ent->listeners; it != NULL; it = it->hh.next) {
+    if (it->hndl->model)
+      model_stat_fill(it->hndl->model, ent->retype);
+  }
+  ent->retype = false;
+}
+
+static mode_t dirent_mode(uv_dirent_type_t type)
+{
+  switch (type) {
+    case UV_DIRENT_DIR:    return S_IFDIR;
+    case UV_DIRENT_LINK:   return S_IFLNK;
+    case UV_DIRENT_FILE:   return S_IFREG;
+    case UV_DIRENT_FIFO:   return S_IFIFO;
+    case UV_DIRENT_SOCKET: return S_IFSOCK;
+    case UV_DIRENT_CHAR:   return S_IFCHR;
+    case UV_DIRENT_BLOCK:  return S_IFBLK;
+    default:
+      return 0;
+  }
+}
+
+#ifdef STATX_TYPE
+#define SCAN_MASK (STATX_TYPE|STATX_MODE|STATX_SIZE|STATX_MTIME|STATX_CTIME)
+
+static bool no_statx;
+
+static void stx_to_stat(struct statx *stx, struct stat *st)
+{
+  memset(st, 0, sizeof(struct stat));
+  st->st_dev     = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+  st->st_ino     = stx->stx_ino;
+  st->st_mode    = stx->stx_mode;
+  st->st_nlink   = stx->stx_nlink;
+  st->st_uid     = stx->stx_uid;
+  st->st_gid     = stx->stx_gid;
+  st->st_rdev    = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+  st->st_size    = stx->stx_size;
+  st->st_blksize = stx->stx_blksize;
+  st->st_blocks  = stx->stx_blocks;
+  st->st_atim    = (struct timespec){stx->stx_atime.tv_sec, stx->stx_atime.tv_nsec};
+  st->st_mtim    = (struct timespec){stx->stx_mtime.tv_sec, stx->stx_mtime.tv_nsec};
+  st->st_ctim    = (struct timespec){stx->stx_ctime.tv_sec, stx->stx_ctime.tv_nsec};
+}
+
+/* request only what is drawn and sorted on. the remaining fields are
+ * whatever the filesystem returns for free. */
+static int scan_statx(const char *path, int flags, struct stat *st)
+{
+  struct statx stx;
+  flags |= AT_SYMLINK_NOFOLLOW;
+  if (statx(AT_FDCWD, path, flags, SCAN_MASK, &stx) == -1)
+    return -1;
+  stx_to_stat(&stx, st);
+  return 0;
+}
+
+/* whole batch in one submission when io_uring is available */
+static bool uring_batch(ScanBatch *batch)
+{
+  struct statx *stx = malloc(batch->count * sizeof(struct statx));
+  int res[SCAN_BATCH];
+  int flags = AT_SYMLINK_NOFOLLOW | batch->flags;
+
+  int ret = uring_statx(batch->paths, batch->count, flags, SCAN_MASK, stx, res);
+  for (int i = 0; i < batch->count && ret != -1; i++) {
+    batch->err[i] = res[i] < 0;
+    if (!batch->err[i])
+      stx_to_stat(&stx[i], &batch->st[i]);
+  }
+  free(stx);
+  return ret != -1;
+}
+#endif
+
+static int scan_stat(const char *path, int flags, struct stat *st)
+{
+#ifdef STATX_TYPE
+  if (!no_statx) {
+    if (scan_statx(path, flags, st) == 0)
+      return 0;
+    if (errno != ENOSYS)
+      return -1;
+    no_statx = true;
+  }
+#endif
+  return lstat(path, st);
+}
+
+/* runs on the threadpool */
+static void stat_batch(uv_work_t *req)
+{
+  ScanBatch *batch = req->data;
+#ifdef STATX_TYPE
+  if (!batch->ent->cancel && uring_batch(batch))
+    return;
+#endif
+  for (int i = 0; i < batch->count; i++) {
+    if (batch->ent->cancel)
+      batch->err[i] = true;
+    else
+      batch->err[i] = scan_stat(batch->paths[i], batch->flags, &batch->st[i]);
+  }
+}
+
+static void stat_batch_cb(uv_work_t *req, int status)
+{
+  ScanBatch *batch = req->data;
+  fentry *ent = batch->ent;
+
+  if (status == 0 && !ent->cancel && batch->lazy) {
+    fill_batch(batch);
+    batch_free(batch);
+  }
+  else if (status == 0 && !ent->cancel) {
+    ent->refs++;
+    CREATE_EVENT(eventq(), commit_batch, 1, batch);
+  }
+  else
+    batch_free(batch);
+
+  ent->pending--;
+  if (ent->pending == 0 && ent->closing) {
+    ent->closing = false;
+    fs_close_req(ent);
+  }
+  else if (ent->pending == 0 && !ent->reading)
+    fill_done(ent);
+  ent_unref(ent);
+}
+
+static void batch_queue(ScanBatch *batch)
+{
+  fentry *ent = batch->ent;
+  ent->pending++;
+  ent->refs++;
+  uv_queue_work(eventloop(), &batch->req, stat_batch, stat_batch_cb);
+}
+
+static int scan_flags()
+{
+#ifdef AT_STATX_DONT_SYNC
+  if (!get_opt_bool("statsync"))
+    return AT_STATX_DONT_SYNC;
+#endif
+  return 0;
+}
+
+static void scan_start(fentry *ent)
+{
+  log_msg("FS", "--scan--");
+  log_msg("FS", "path: %s", ent->key);
+  if (ent->warm) {
+    ent->warm = false;
+    ent->reopen = true;
+  }
   fs_flush_stream(ent);
 
   /* clear outdated records */
-  tbl_del_val("fm_files", "dir", (char*)req->path);
+  tbl_del_val("fm_files", "dir", ent->key);
+
+  add_dir(ent->key, &ent->scankey);
 
-  add_dir(req->path, req->statbuf);
+  /* stat runs off the loop; records are committed as batches return.
+   * lazily, records are committed as read with d_type, filled in later. */
+  ent->lazy = get_opt_bool("lazystat");
+  ent->scanflags = scan_flags();
+  ent->committed = 0;
+  ent->published = 0;
+}
 
-  while (UV_EOF != uv_fs_scandir_next(req, &dent) && (!ent->cancel)) {
-    int err = 0;
-    trans_rec *r = mk_trans_rec(tbl_fld_count("fm_files"));
-    edit_trans(r, "name", (char*)dent.name, NULL);
-    edit_trans(r, "dir",  (char*)req->path, NULL);
-    char *full = conspath(req->path, dent.name);
-    edit_trans(r, "fullpath", (char*)full, NULL);
+static void closedir_cb(uv_fs_t *req)
+{
+  fentry *ent = req->data;
+  uv_fs_req_cleanup(req);
+  free(ent->dents);
+  ent->dents = NULL;
+  ent->scandir = NULL;
+  ent->reading = false;
 
-    err = edit_trans_stat(r, full, 0);
-    free(full);
+  if (!ent->lazy && ent->pending > 0)
+    ent->closing = true;
+  else
+    fs_close_req(ent);
+}
 
-    if (err)
-      clear_trans(r, 1);
-    else
-      CREATE_EVENT(eventq(), commit, 2, "fm_files", r);
+/* the directory is read SCAN_BATCH entries at a time, each read becoming
+ * one stat batch, so records stream in before the read completes. */
+static void readdir_cb(uv_fs_t *req)
+{
+  fentry *ent = req->data;
+  uv_dir_t *dir = ent->scandir;
+  int count = req->result;
+
+  ScanBatch *batch = NULL;
+  for (int i = 0; i < count && !ent->cancel; i++) {
+    if (!batch)
+      batch = batch_new(ent, ent->lazy, ent->scanflags);
+
+    uv_dirent_t *dent = &dir->dirents[i];
+    int j = batch->count++;
+    batch->names[j] = strdup(dent->name);
+    batch->paths[j] = conspath(ent->key, dent->name);
+
+    if (ent->lazy) {
+      memset(&batch->st[j], 0, sizeof(struct stat));
+      batch->st[j].st_mode = dirent_mode(dent->type);
+      commit_entry(batch, j);
+    }
   }
-  uv_fs_req_cleanup(&ent->uv_fs);
-  fs_close_req(ent);
+  if (batch) {
+    if (ent->lazy)
+      scan_publish(ent, batch->count);
+    batch_queue(batch);
+  }
+
+  uv_fs_req_cleanup(req);
+  if (count > 0 && !ent->cancel)
+    uv_fs_readdir(eventloop(), req, dir, readdir_cb);
+  else
+    uv_fs_closedir(eventloop(), req, dir, closedir_cb);
+}
+
+static void opendir_cb(uv_fs_t *req)
+{
+  fentry *ent = req->data;
+  scan_start(ent);
+  if (req->result < 0) {
+    log_err("FS", "opendir_cb: |%s|", uv_strerror(req->result));
+    uv_fs_req_cleanup(req);
+    return fs_close_req(ent);
+  }
+
+  ent->reading = true;
+  ent->scandir = req->ptr;
+  ent->dents = malloc(SCAN_BATCH * sizeof(uv_dirent_t));
+  ent->scandir->dirents = ent->dents;
+  ent->scandir->nentries = SCAN_BATCH;
+  uv_fs_req_cleanup(req);
+  if (ent->cancel)
+    uv_fs_closedir(eventloop(), req, ent->scandir, closedir_cb);
+  else
+    uv_fs_readdir(eventloop(), req, ent->scandir, readdir_cb);
 }
 
 static void stat_cb(uv_fs_t *req)
@@ -441,6 +1269,7 @@ static void stat_cb(uv_fs_t *req)
 
   if (!(doscan = S_ISDIR(stat.st_mode)))
     goto scandir;
+  ent->scankey = dir_key(&stat);
 
   cachedir *cache;
   HASH_FIND_STR(cache_tbl, req->path, cache);
@@ -448,16 +1277,17 @@ static void stat_cb(uv_fs_t *req)
   if (!cache || ent->flush)
     goto scandir;
 
-  if (!difftime(stat.st_ctim.tv_sec, cache->ctimesec)) {
+  if (dir_key_eq(&ent->scankey, &cache->dk)) {
     log_msg("FS", "STAT:NOP");
     doscan = false;
+    ent->warm = false;
   }
 
 scandir:
   ent->before = os_hrtime();
   uv_fs_req_cleanup(req);
   if (doscan)
-    uv_fs_scandir(eventloop(), &ent->uv_fs, ent->key, 0, scan_cb);
+    uv_fs_opendir(eventloop(), &ent->uv_fs, ent->key, opendir_cb);
   else
     fs_close_req(ent);
 }
@@ -487,23 +1317,204 @@ static void watch_timer_cb(uv_timer_t *handle)
 {
   log_msg("FS", "--watch_timer--");
   fentry *ent = handle->data;
-  if (!ent->running)
+  if (!ent->running) {
+    watch_settle(ent);
     fs_reopen(ent);
+  }
+}
+
+/* upsert entries that still stat, remove those that don't. listing
+ * models are rebuilt from the table as after a rescan. */
+static void delta_apply(ScanBatch *batch)
+{
+  log_msg("FS", "--delta-- %d", batch->count);
+  fentry *ent = batch->ent;
+  nv_fs *it = NULL;
+  for (it = ent->listeners; it != NULL; it = it->hh.next) {
+    if (it->hndl->model)
+      model_flush(it->hndl, true);
+  }
+
+  for (int i = 0; i < batch->count; i++) {
+    Ventry *rec = fnd_val("fm_files", "fullpath", batch->paths[i]);
+    if (batch->err[i] && rec)
+      tbl_del_val("fm_files", "fullpath", batch->paths[i]);
+    else if (batch->err[i])
+      continue;
+    else if (rec)
+      *(struct stat*)rec_fld(rec->rec, "stat") = batch->st[i];
+    else
+      commit_entry(batch, i);
+  }
+
+  for (it = ent->listeners; it != NULL; it = it->hh.next) {
+    if (it->hndl->model)
+      model_recv(it->hndl->model);
+  }
+}
+
+static void delta_batch_cb(uv_work_t *req, int status)
+{
+  ScanBatch *batch = req->data;
+  fentry *ent = batch->ent;
+
+  /* a scan that started since has the newer listing */
+  bool stale = ent->running || HASH_COUNT(ent->listeners) < 1;
+  if (status == 0 && !ent->cancel && !stale)
+    delta_apply(batch);
+
+  batch_free(batch);
+  ent_unref(ent);
+}
+
+/* coalescing window for an update, doubled per churning window */
+static uint64_t watch_wait(fentry *ent, uint64_t base)
+{
+  if (ent->policy != WATCH_ADAPTIVE)
+    return base;
+  return MAX(base, MIN(base << ent->backoff, BACKOFF_MAX));
+}
+
+static uint watch_heat(fentry *ent, uint64_t now)
+{
+  uint64_t halves = (now - ent->last_event)/1000000/HEAT_HALF;
+  return halves < 32 ? ent->heat >> halves : 0;
+}
+
+static void watch_event(fentry *ent)
+{
+  uint64_t now = os_hrtime();
+  ent->heat = watch_heat(ent, now) + 1;
+  ent->last_event = now;
+  ent->burst++;
+  ent->events++;
+}
+
+/* open an update window. a backed off window is held open only while
+ * events keep arriving, so a settled update follows once churn stops. */
+static void watch_arm(fentry *ent, uv_timer_t *timer, uv_timer_cb cb,
+    uint64_t base, uint64_t repeat)
+{
+  uint64_t now = os_hrtime();
+  if (!uv_is_active((uv_handle_t*)timer)) {
+    uint64_t wait = watch_wait(ent, base);
+    ent->deadline = now + wait*1000000;
+    uv_timer_start(timer, cb, wait, repeat);
+  }
+  else if (ent->policy == WATCH_ADAPTIVE && ent->backoff > 0) {
+    uint64_t left = ent->deadline > now ? (ent->deadline - now)/1000000 : 0;
+    uv_timer_start(timer, cb, MIN(left, SETTLE_WAIT), repeat);
+  }
+}
+
+/* an update is being delivered. churn widens the next window and a
+ * quiet one settles it back. */
+static void watch_settle(fentry *ent)
+{
+  ent->suppressed += MAX(ent->burst - 1, 0);
+  ent->burst = 0;
+  if (ent->policy != WATCH_ADAPTIVE)
+    return;
+
+  uint heat = watch_heat(ent, os_hrtime());
+  if (heat <= CHURN_RATE)
+    ent->backoff = 0;
+  else if (ent->backoff < BACKOFF_STEPS)
+    ent->backoff++;
+  log_msg("FS", "settle %s heat %u backoff %d", ent->key, heat, ent->backoff);
+}
+
+static void delta_timer_cb(uv_timer_t *handle)
+{
+  fentry *ent = handle->data;
+  watch_settle(ent);
+  ScanBatch *batch = ent->delta;
+  ent->delta = NULL;
+  ent->refs++;
+  uv_queue_work(eventloop(), &batch->req, stat_batch, delta_batch_cb);
+}
+
+static void delta_drop(fentry *ent)
+{
+  uv_timer_stop(&ent->delta_timer);
+  if (ent->delta)
+    batch_free(ent->delta);
+  ent->delta = NULL;
+}
+
+/* coalesce names reported by the watcher into one stat batch */
+static bool delta_add(fentry *ent, const char *name)
+{
+  ScanBatch *batch = ent->delta;
+  if (!batch)
+    batch = ent->delta = batch_new(ent, false, scan_flags());
+
+  bool found = false;
+  for (int i = 0; i < batch->count && !found; i++)
+    found = !strcmp(batch->names[i], name);
+
+  if (!found && batch->count == SCAN_BATCH)
+    return false;
+
+  if (!found) {
+    int i = batch->count++;
+    batch->names[i] = strdup(name);
+    batch->paths[i] = conspath(ent->key, name);
+  }
+  watch_arm(ent, &ent->delta_timer, delta_timer_cb, DELTA_WAIT, 0);
+  return true;
 }
 
 static void watch_cb(uv_fs_event_t *hndl, const char *fname, int events, int s)
 {
   log_msg("FS", "--watch--");
   fentry *ent = hndl->data;
+  watch_event(ent);
+  if (ent->policy == WATCH_OFF) {
+    ent->suppressed++;
+    ent->burst = 0;
+    return;
+  }
 
-  uv_fs_event_stop(&ent->watcher);
-  uv_timer_start(&ent->watcher_timer, watch_timer_cb, MAX_WAIT, MAX_WAIT);
+  /* a pending rescan covers anything that follows */
+  if (uv_is_active((uv_handle_t*)&ent->watcher_timer))
+    return watch_arm(ent, &ent->watcher_timer, watch_timer_cb,
+        MAX_WAIT, MAX_WAIT);
+
+  /* events on the directory itself are reported under its basename.
+   * those, nameless events and bursts too large to batch rescan. */
+  char *base = strrchr(ent->key, '/');
+  bool self = !fname || !strcmp(fname, base ? base + 1 : ent->key);
+  if (!self && !ent->running && delta_add(ent, fname))
+    return;
+
+  delta_drop(ent);
+  watch_arm(ent, &ent->watcher_timer, watch_timer_cb, MAX_WAIT, MAX_WAIT);
 
   uint64_t now = os_hrtime();
-  if ((now - ent->before)/1000000 > MAX_WAIT)
+  if (ent->backoff == 0 && (now - ent->before)/1000000 > MAX_WAIT)
     watch_timer_cb(&ent->watcher_timer);
 }
 
+char* fs_watch_info(const char *path, const char *name)
+{
+  fentry *ent = NULL;
+  HASH_FIND_STR(ent_tbl, path, ent);
+  if (!ent || !name)
+    return NULL;
+
+  char *str = NULL;
+  if (!strcmp(name, "events"))
+    asprintf(&str, "%u", ent->events);
+  else if (!strcmp(name, "suppressed"))
+    asprintf(&str, "%u", ent->suppressed);
+  else if (!strcmp(name, "wait"))
+    asprintf(&str, "%" PRIu64, watch_wait(ent, DELTA_WAIT));
+  else if (!strcmp(name, "policy"))
+    str = strdup(policy_names[ent->policy]);
+  return str;
+}
+
 void fs_reload(char *path)
 {
   fentry *ent = NULL;
@@ -518,5 +1529,7 @@ void fs_reload(char *path)
 static void fs_close_req(fentry *ent)
 {
   log_msg("FS", "reset %s", ent->key);
+  /* held until the signal is handled */
+  ent->refs++;
   CREATE_EVENT(eventq(), fs_signal_handle, 1, ent);
 }
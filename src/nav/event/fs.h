@@ -5,18 +5,17 @@
 #include "nav/table.h"
 
 typedef struct fentry fentry;
+typedef struct FsRead FsRead;
 typedef struct nv_fs nv_fs;
 
 struct nv_fs {
   char *path;
 
   Handle *hndl;
-  uv_fs_t uv_fs;  /* readonly stat */
-  char *readkey;
+  FsRead *read;   /* path resolve in flight */
   fentry *ent;
 
   void *data;
-  bool running;
   argv_callback open_cb;
   argv_callback stat_cb;
   UT_hash_handle hh;
@@ -30,6 +29,9 @@ void fs_read(nv_fs *fs, const char *);
 void fs_clr_cache(char *);
 void fs_clr_all_cache();
 void fs_reload(char *);
+char* fs_watch_info(const char *, const char *);
+void fs_prefetch(const char *, const char *);
+void fs_cache_save();
 
 void fs_cancel(nv_fs *fs);
 void fs_fastreq(nv_fs *fs);
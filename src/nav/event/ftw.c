@@ -1,134 +1,469 @@
-//file tree walk
+//file tree walk on a dedicated thread
 #include <malloc.h>
+#include <libgen.h>
 #include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <uv.h>
 #include "nav/event/ftw.h"
 #include "nav/log.h"
 #include "nav/util.h"
 #include "nav/event/event.h"
+#include "nav/event/fs.h"
+#include "nav/event/rmtree.h"
+#include "nav/event/trash.h"
+#include "nav/event/ioprio.h"
+#include "nav/event/workq.h"
+#include "nav/option.h"
+
+#define RING_SIZE 4096  /* walked entries waiting on the loop */
+#define GROUP_MAX 8192  /* items a group holds before the ring backs up */
+#define WALK_OPEN O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC
+
+enum walk_msg {
+  WALK_ROOT,      //size and device pair of the root
+  WALK_ITEM,      //new item for the group
+  WALK_DIR_END,   //walk left the item, drop its walk ref
+  WALK_END,       //group fully walked
+  WALK_TRASH,     //item moved to the trash in item->dest, or not
+};
 
 typedef struct {
-  bool running;
-  bool cancel;
-  uint64_t before;
-  int count;
-  int depth;
-  FileItem  *cur;
+  int type;
+  bool isdir;
+  FileGroup *fg;
+  FileItem *item;
+  uint64_t size;
+  int err;
+  dev_t src, dst;     //WALK_ROOT
+} WalkMsg;
+
+typedef struct FtwJob FtwJob;
+struct FtwJob {
+  TAILQ_ENTRY(FtwJob) ent;
   FileGroup *fg;
-  TAILQ_HEAD(Groups, FileGroup) p;
+  FileItem *root;
+  bool unlink;        //plain remove, done by the walker
+  int jobs;           //delete threads
+  char *purge;        //trash dir to purge instead of a walk
+  bool trash;         //move root to the trash instead of a walk
+  time_t before;
+  JobPrio io;
+};
+
+/* the walker only produces into ring; item refs and group fields are
+ * touched on the loop thread as messages drain. a directory holds a walk
+ * ref until its WALK_DIR_END so it outlives children still being walked. */
+typedef struct {
+  uv_thread_t thread;
+  uv_mutex_t lock;    //guards p and quit
+  uv_cond_t cond;
+  uv_sem_t slots;     //free ring slots
+  uv_async_t async;
+  bool running;
+  bool quit;
+  int cancel;
+  int pending;        //groups not yet fully walked
+  FileGroup *cur;     //group being walked, guarded by lock
+  WorkQ *sizeq;       //preflight sizing
+  FileGroup *stall;   //group whose full queue stopped the drain
+  TAILQ_HEAD(Jobs, FtwJob) p;
+  unsigned head;      //loop side
+  unsigned tail;      //walker side
+  WalkMsg ring[RING_SIZE];
 } Ftw;
 static Ftw ftw;
 
-void ftw_init()
+static bool walk_quit()
 {
-  TAILQ_INIT(&ftw.p);
-  ftw.running = false;
+  return __atomic_load_n(&ftw.quit, __ATOMIC_ACQUIRE);
 }
 
-void ftw_cleanup()
+static void ring_push(WalkMsg msg)
 {
-  //cancel items
+  if (walk_quit())
+    return;
+  uv_sem_wait(&ftw.slots);
+  if (walk_quit())
+    return;
+
+  unsigned tail = ftw.tail;
+  ftw.ring[tail % RING_SIZE] = msg;
+  __atomic_store_n(&ftw.tail, tail + 1, __ATOMIC_RELEASE);
+  uv_async_send(&ftw.async);
 }
 
-static void add_ent(const char *str, struct stat *sb, int isdir)
+static void walk_recv(WalkMsg *m)
 {
-  log_msg("FTW", "add ent %s %d", str, ftw.depth);
-  ftw.count++;
-  ftw.fg->tsize += sb->st_size;
+  FileGroup *fg = m->fg;
+  switch (m->type) {
+    case WALK_ROOT:
+      fg->tsize += m->size;
+      fg->tfiles++;
+      file_lane(fg, m->src, m->dst);
+      break;
+    case WALK_ITEM:
+      fg->tsize += m->size;
+      fg->tfiles++;
+      m->item->parent->refs++;
+      m->item->refs += m->isdir;
+      TAILQ_INSERT_TAIL(&fg->p, m->item, ent);
+      fg->queued++;
+      break;
+    case WALK_DIR_END:
+      file_release(fg, m->item, m->isdir);
+      break;
+    case WALK_END:
+      fg->walking = false;
+      if (--ftw.pending == 0)
+        uv_unref((uv_handle_t*)&ftw.async);
+      break;
+    case WALK_TRASH:
+      if (--ftw.pending == 0)
+        uv_unref((uv_handle_t*)&ftw.async);
+      file_trashed(m->item->src, m->item->dest, m->err);
+      free(m->item->src);
+      free(m->item->dest);
+      free(m->item);
+      break;
+  }
+}
+
+/* items stay in the ring while their group holds GROUP_MAX, so the
+ * ring fills and the walker blocks instead of the queue growing with
+ * the tree. file_start resumes the drain once the group has room. */
+static void ring_drain(uv_async_t *hndl)
+{
+  unsigned tail = __atomic_load_n(&ftw.tail, __ATOMIC_ACQUIRE);
+  int n = 0;
+  ftw.stall = NULL;
+  while (ftw.head != tail && n < RING_SIZE) {
+    WalkMsg *m = &ftw.ring[ftw.head % RING_SIZE];
+    if (m->type == WALK_ITEM && m->fg->queued >= GROUP_MAX) {
+      ftw.stall = m->fg;
+      break;
+    }
+    walk_recv(m);
+    ftw.head++;
+    n++;
+    uv_sem_post(&ftw.slots);
+  }
 
-  if (ftw.depth == 0)
+  /* leave the rest for the next loop iteration */
+  if (!ftw.stall && ftw.head != __atomic_load_n(&ftw.tail, __ATOMIC_ACQUIRE))
+    uv_async_send(&ftw.async);
+  file_start();
+}
+
+void ftw_resume()
+{
+  if (ftw.stall && ftw.stall->queued < GROUP_MAX / 2) {
+    ftw.stall = NULL;
+    uv_async_send(&ftw.async);
+  }
+}
+
+static void walk_dir(FileGroup *, FileItem *, int);
+
+/* entries are resolved against their parent's descriptor. only the
+ * item paths handed to the file queue are built in full. */
+static void walk_ent(FileGroup *fg, FileItem *parent, int dfd,
+    const char *name)
+{
+  struct stat st;
+  if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)
     return;
 
+  int isdir = S_ISDIR(st.st_mode);
   FileItem *item = calloc(1, sizeof(FileItem));
-  item->src = strdup(str);
-  item->parent = ftw.cur;
-  ftw.cur->refs++;
-  TAILQ_INSERT_TAIL(&ftw.fg->p, item, ent);
+  item->src = conspath(parent->src, name);
+  item->parent = parent;
+  ring_push((WalkMsg){WALK_ITEM, isdir, fg, item, st.st_size});
 
   if (isdir)
-    ftw.cur = item;
-
-  //TODO: onerror, pop item from ftw_queue
+    walk_dir(fg, item, openat(dfd, name, WALK_OPEN));
 }
 
-static void do_ftw(const char *path)
+/* consumes fd */
+static void walk_dir(FileGroup *fg, FileItem *item, int fd)
 {
-  char buf[PATH_MAX], *p;
+  DIR *dp = fd == -1 ? NULL : fdopendir(fd);
+  if (!dp) {
+    log_err("FTW", "opendir failed %s", item->src);
+    if (fd != -1)
+      close(fd);
+  }
+
   struct dirent *d;
+  while (dp && (d = readdir(dp))) {
+    if (__atomic_load_n(&ftw.cancel, __ATOMIC_RELAXED))
+      break;
+
+    if (strcmp(d->d_name, ".") == 0 ||
+        strcmp(d->d_name, "..") == 0)
+      continue;
+
+    walk_ent(fg, item, dirfd(dp), d->d_name);
+  }
+
+  if (dp)
+    closedir(dp);
+  ring_push((WalkMsg){WALK_DIR_END, true, fg, item});
+}
+
+/* the dest may not exist yet; its directory decides */
+static dev_t dest_dev(const char *dest)
+{
   struct stat st;
-  DIR *dp;
+  if (stat(dest, &st) == 0)
+    return st.st_dev;
+  char *dir = strdup(dest);
+  int ret = stat(dirname(dir), &st);
+  free(dir);
+  return ret == 0 ? st.st_dev : 0;
+}
 
-  if (lstat(path, &st) == -1)
-    return;
+/* the root is always reported, it puts the group in a lane */
+static void walk(FtwJob *job)
+{
+  FileGroup *fg = job->fg;
+  FileItem *root = job->root;
 
-  int isdir = S_ISDIR(st.st_mode);
+  struct stat st;
+  bool isdir = false;
+  if (lstat(root->src, &st) == 0)
+    isdir = S_ISDIR(st.st_mode);
+  else
+    memset(&st, 0, sizeof(st));
+  dev_t dst = root->dest ? dest_dev(root->dest) : st.st_dev;
+  ring_push((WalkMsg){WALK_ROOT, isdir, fg, root, st.st_size,
+      .src = st.st_dev, .dst = dst});
+
+  /* the root itself is left to the file queue */
+  if (isdir && job->unlink) {
+    rmtree(open(root->src, WALK_OPEN), job->jobs, &ftw.cancel);
+    ring_push((WalkMsg){WALK_DIR_END, true, fg, root});
+  }
+  else if (isdir)
+    walk_dir(fg, root, open(root->src, WALK_OPEN));
+  else
+    ring_push((WalkMsg){WALK_DIR_END, false, fg, root});
 
-  add_ent(path, &st, isdir);
+  if (__atomic_load_n(&ftw.cancel, __ATOMIC_RELAXED))
+    log_err("FTW", "<|_CANCEL_|>");
+  ring_push((WalkMsg){WALK_END, false, fg});
+}
 
-  if (!isdir)
-    return;
+static void walk_trash(FtwJob *job)
+{
+  FileItem *item = job->root;
+  item->dest = trash_put(item->src);
+  int err = item->dest ? 0 : errno;
+  ring_push((WalkMsg){WALK_TRASH, false, NULL, item, .err = err});
+}
 
-  if (!(dp = opendir(path)))
-    log_err("FTW", "opendir failed %s", path);
+typedef struct {
+  WorkReq work;
+  FileGroup *fg;
+  char *path;
+  uint64_t size;
+  uint64_t count;
+} Preflight;
 
-  ftw.depth++;
+/* same accounting as the walk: every entry's st_size. consumes fd */
+static void du(Preflight *pf, int fd)
+{
+  DIR *dp = fd == -1 ? NULL : fdopendir(fd);
+  if (!dp) {
+    if (fd != -1)
+      close(fd);
+    return;
+  }
 
+  struct dirent *d;
+  struct stat st;
   while ((d = readdir(dp))) {
-    if (ftw.cancel) {
-      log_err("FTW", "<|_CANCEL_|>");
+    if (__atomic_load_n(&ftw.quit, __ATOMIC_RELAXED) ||
+        __atomic_load_n(&pf->fg->cancel, __ATOMIC_RELAXED))
       break;
-    }
-
-    uint64_t now = os_hrtime();
-    if ((now - ftw.before)/1000000 > MAX_WAIT) {
-      event_cycle_once();
-      ftw.before = os_hrtime();
-    }
-
     if (strcmp(d->d_name, ".") == 0 ||
         strcmp(d->d_name, "..") == 0)
       continue;
+    if (fstatat(dirfd(dp), d->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+      continue;
 
-    strncpy(buf, path, sizeof(buf));
-    p = strrchr(buf, '\0');
+    pf->size += st.st_size;
+    pf->count++;
+    if (S_ISDIR(st.st_mode))
+      du(pf, openat(dirfd(dp), d->d_name, WALK_OPEN));
+  }
+  closedir(dp);
+}
 
-    /* remove all trailing slashes */
-    while (--p >= buf && *p == '/')
-      *p ='\0';
+static void preflight_work(WorkReq *req)
+{
+  Preflight *pf = req->data;
+  struct stat st;
+  if (lstat(pf->path, &st) == -1)
+    return;
+  pf->size = st.st_size;
+  pf->count = 1;
+  if (!S_ISDIR(st.st_mode))
+    return;
 
-    strcat(buf, "/");
-    strcat(buf, d->d_name);
+  ioprio_thread(pf->fg->io);
+  du(pf, open(pf->path, WALK_OPEN));
+}
+
+static void preflight_done(WorkReq *req)
+{
+  Preflight *pf = req->data;
+  FileGroup *fg = pf->fg;
+  fg->total = pf->size;
+  fg->pfiles = pf->count;
+  fg->sizing = false;
+  free(pf->path);
+  free(pf);
+  file_start();
+}
 
-    do_ftw(buf);
+/* size the tree ahead of the walk, which the ring holds to GROUP_MAX
+ * queued items. sizing has a thread of its own so a large tree neither
+ * holds the pool scans need nor leaves it at background priority. the
+ * group is held until this returns. */
+static void ftw_preflight(FileGroup *fg, const char *path)
+{
+  Preflight *pf = calloc(1, sizeof(Preflight));
+  pf->fg = fg;
+  pf->path = strdup(path);
+  pf->work.data = pf;
+  fg->sizing = true;
+  workq_push(ftw.sizeq, &pf->work, preflight_work, preflight_done);
+}
+
+static void walk_thread(void *arg)
+{
+  uv_mutex_lock(&ftw.lock);
+  while (!ftw.quit) {
+    FtwJob *job = TAILQ_FIRST(&ftw.p);
+    if (!job) {
+      uv_cond_wait(&ftw.cond, &ftw.lock);
+      continue;
+    }
+    TAILQ_REMOVE(&ftw.p, job, ent);
+    ftw.cur = job->fg;
+    __atomic_store_n(&ftw.cancel, 0, __ATOMIC_RELAXED);
+    uv_mutex_unlock(&ftw.lock);
+
+    /* rmtree threads spawned from here inherit it */
+    ioprio_thread(job->io);
+
+    if (job->purge)
+      trash_purge(job->purge, job->before, job->jobs, &ftw.cancel);
+    else if (job->trash)
+      walk_trash(job);
+    else
+      walk(job);
+    free(job->purge);
+    free(job);
+    log_msg("FTW", "Finished");
+
+    uv_mutex_lock(&ftw.lock);
+    ftw.cur = NULL;
   }
+  uv_mutex_unlock(&ftw.lock);
+}
 
-  ftw.depth--;
-  ftw.cur = ftw.cur->parent;
-  closedir(dp);
+void ftw_init()
+{
+  TAILQ_INIT(&ftw.p);
+  uv_mutex_init(&ftw.lock);
+  uv_cond_init(&ftw.cond);
+  uv_sem_init(&ftw.slots, RING_SIZE);
+  uv_async_init(eventloop(), &ftw.async, ring_drain);
+  uv_unref((uv_handle_t*)&ftw.async);
+  ftw.sizeq = workq_new(1);
+  ftw.running = !uv_thread_create(&ftw.thread, walk_thread, NULL);
+}
+
+void ftw_cleanup()
+{
+  if (!ftw.running)
+    return;
+  uv_mutex_lock(&ftw.lock);
+  __atomic_store_n(&ftw.quit, true, __ATOMIC_RELEASE);
+  __atomic_store_n(&ftw.cancel, 1, __ATOMIC_RELAXED);
+  uv_cond_signal(&ftw.cond);
+  uv_mutex_unlock(&ftw.lock);
+
+  /* wake a walker blocked on a full ring */
+  uv_sem_post(&ftw.slots);
+  uv_thread_join(&ftw.thread);
+  workq_free(ftw.sizeq);
+  ftw.running = false;
+  uv_close((uv_handle_t*)&ftw.async, NULL);
 }
 
 void ftw_cancel()
 {
-  ftw.cancel = true;
+  __atomic_store_n(&ftw.cancel, 1, __ATOMIC_RELAXED);
 }
 
-static void ftw_start()
+/* stop walking one group. a job still queued is dropped as if its walk
+ * came up empty. */
+void ftw_stop(FileGroup *fg)
 {
-  ftw.running = true;
-  ftw.cancel = false;
-  ftw.depth = 0;
-  ftw.before = os_hrtime();
+  uv_mutex_lock(&ftw.lock);
+  FtwJob *job;
+  TAILQ_FOREACH(job, &ftw.p, ent) {
+    if (job->fg == fg)
+      break;
+  }
+  if (job)
+    TAILQ_REMOVE(&ftw.p, job, ent);
+  else if (ftw.cur == fg)
+    __atomic_store_n(&ftw.cancel, 1, __ATOMIC_RELAXED);
+  uv_mutex_unlock(&ftw.lock);
 
-  ftw.fg = TAILQ_FIRST(&ftw.p);
-  ftw.cur = TAILQ_FIRST(&ftw.fg->p);
-  do_ftw(ftw.cur->src);
-  TAILQ_REMOVE(&ftw.p, ftw.fg, ent);
+  if (!job)
+    return;
+  file_release(fg, job->root, false);
+  fg->walking = false;
+  if (--ftw.pending == 0)
+    uv_unref((uv_handle_t*)&ftw.async);
+  free(job);
+}
 
-  log_msg("FTW", "Finished");
+/* the group starts in the file queue at once; the walk feeds it */
+static void ftw_queue(FileItem *root, FileGroup *fg, bool head)
+{
+  FtwJob *job = malloc(sizeof(FtwJob));
+  job->fg = fg;
+  job->root = root;
+  job->purge = NULL;
+  job->trash = false;
+  job->unlink = fg->flags == F_UNLINK;
+  job->jobs = get_opt_uint("copyjobs");
+  job->io = fg->io;
+
+  root->refs = 1;
+  fg->walking = true;
+  if (!job->unlink)
+    ftw_preflight(fg, root->src);
+  if (ftw.pending++ == 0)
+    uv_ref((uv_handle_t*)&ftw.async);
+  TAILQ_INSERT_TAIL(&fg->p, root, ent);
+  fg->queued++;
+  file_push(fg);
 
-  //check for more entries
-  ftw.running = false;
-  file_push(ftw.fg);
+  uv_mutex_lock(&ftw.lock);
+  if (head)
+    TAILQ_INSERT_HEAD(&ftw.p, job, ent);
+  else
+    TAILQ_INSERT_TAIL(&ftw.p, job, ent);
+  uv_cond_signal(&ftw.cond);
+  uv_mutex_unlock(&ftw.lock);
 }
 
 FileItem* ftw_new(char *src, char *dest)
@@ -138,6 +473,8 @@ FileItem* ftw_new(char *src, char *dest)
   item->dest = dest ? strdup(dest) : NULL;
   item->parent = NULL;
   item->refs = 0;
+  item->made = false;
+  item->dropped = false;
   return item;
 }
 
@@ -146,7 +483,9 @@ void ftw_push_move(char *src, char *dest, FileGroup *fg)
   log_msg("FTW", "pushed_move");
   FileItem *item = ftw_new(src, dest);
   TAILQ_INSERT_TAIL(&fg->p, item, ent);
+  fg->queued++;
   fg->flags = F_MOVE|F_VERSIONED;
+  fg->tfiles = 1;
 
   //NOTE: copying across devices will fail and be readded as copy
   file_push(fg);
@@ -155,40 +494,60 @@ void ftw_push_move(char *src, char *dest, FileGroup *fg)
 void ftw_push_copy(char *src, char *dest, FileGroup *fg)
 {
   log_msg("FTW", "pushed_copy");
-  FileItem *item = ftw_new(src, dest);
-  TAILQ_INSERT_TAIL(&fg->p, item, ent);
-  TAILQ_INSERT_TAIL(&ftw.p, fg, ent);
-
   fg->flags |= F_COPY|F_VERSIONED;
-  if (!ftw.running)
-    ftw_start();
+  ftw_queue(ftw_new(src, dest), fg, false);
 }
 
 void ftw_push_remove(char *src, FileGroup *fg)
 {
   log_msg("FTW", "pushed_remove");
-  FileItem *item = ftw_new(src, NULL);
-  TAILQ_INSERT_TAIL(&fg->p, item, ent);
-  TAILQ_INSERT_TAIL(&ftw.p, fg, ent);
-
   fg->flags = F_UNLINK;
-  if (!ftw.running)
-    ftw_start();
+  ftw_queue(ftw_new(src, NULL), fg, false);
 }
 
-//enqueue but don't start
+//walk ahead of queued groups
 void ftw_add_again(char *src, char *dst, FileGroup *fg)
 {
-  FileItem *item = ftw_new(src, dst);
-  TAILQ_INSERT_TAIL(&fg->p, item, ent);
-  TAILQ_INSERT_HEAD(&ftw.p, fg, ent);
   fg->flags |= F_COPY;
+  ftw_queue(ftw_new(src, dst), fg, true);
+}
+
+void ftw_trash(char *src)
+{
+  log_msg("FTW", "pushed_trash");
+  FtwJob *job = calloc(1, sizeof(FtwJob));
+  job->root = ftw_new(src, NULL);
+  job->trash = true;
+  job->io = ioprio_job();
+
+  if (ftw.pending++ == 0)
+    uv_ref((uv_handle_t*)&ftw.async);
+  uv_mutex_lock(&ftw.lock);
+  TAILQ_INSERT_TAIL(&ftw.p, job, ent);
+  uv_cond_signal(&ftw.cond);
+  uv_mutex_unlock(&ftw.lock);
+}
+
+/* queued behind any walk */
+void ftw_purge(const char *dir, time_t before)
+{
+  FtwJob *job = calloc(1, sizeof(FtwJob));
+  job->purge = strdup(dir);
+  job->before = before;
+  job->jobs = get_opt_uint("copyjobs");
+  job->io = ioprio_job();
+
+  uv_mutex_lock(&ftw.lock);
+  TAILQ_INSERT_TAIL(&ftw.p, job, ent);
+  uv_cond_signal(&ftw.cond);
+  uv_mutex_unlock(&ftw.lock);
 }
 
 void ftw_retry()
 {
-  if (!ftw.running)
-    ftw_start();
+  uv_mutex_lock(&ftw.lock);
+  uv_cond_signal(&ftw.cond);
+  uv_mutex_unlock(&ftw.lock);
 }
 
 void ftw_add(char *src, char *dst, FileGroup *fg)
@@ -9,6 +9,10 @@ void ftw_cleanup();
 void ftw_add(char*, char *, FileGroup*);
 void ftw_add_again(char*, char *, FileGroup*);
 void ftw_cancel();
+void ftw_stop(FileGroup*);
+void ftw_trash(char*);
+void ftw_purge(const char *dir, time_t before);
 void ftw_retry();
+void ftw_resume();
 
 #endif
@@ -0,0 +1,57 @@
+//io scheduling class and nice for file job threads
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "nav/event/ioprio.h"
+#include "nav/option.h"
+#include "nav/macros.h"
+#include "nav/log.h"
+
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE    2
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_VALUE(class, data) (((class) << IOPRIO_CLASS_SHIFT) | (data))
+
+JobPrio ioprio_job()
+{
+  JobPrio prio = {
+    .ioprio = -1,
+    .nice = MIN(get_opt_uint("jobnice"), 19),
+  };
+  const char *class = get_opt_str("ioclass");
+  if (!strcmp(class, "idle"))
+    prio.ioprio = IOPRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+  else if (!strcmp(class, "besteffort"))
+    prio.ioprio = IOPRIO_VALUE(IOPRIO_CLASS_BE,
+        MIN(get_opt_uint("iolevel"), 7));
+  return prio;
+}
+
+static int set_ioprio(int ioprio)
+{
+#ifdef SYS_ioprio_set
+  return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+void ioprio_thread(JobPrio prio)
+{
+  if (prio.ioprio != -1 && set_ioprio(prio.ioprio) == -1)
+    log_err("IOPRIO", "ioprio_set: %s", strerror(errno));
+
+#ifdef SYS_gettid
+  /* per thread on linux. only ever raised, lowering needs privilege */
+  pid_t tid = syscall(SYS_gettid);
+  errno = 0;
+  int cur = getpriority(PRIO_PROCESS, tid);
+  if (errno == 0 && prio.nice > cur &&
+      setpriority(PRIO_PROCESS, tid, prio.nice) == -1)
+    log_err("IOPRIO", "setpriority: %s", strerror(errno));
+#endif
+}
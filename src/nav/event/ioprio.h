@@ -0,0 +1,18 @@
+#ifndef NV_EVENT_IOPRIO_H
+#define NV_EVENT_IOPRIO_H
+
+/* io class and nice value for background file work. read from the
+ * options on the loop thread, applied by the worker itself. */
+typedef struct {
+  int ioprio;     //-1 leaves the io class alone
+  int nice;
+} JobPrio;
+
+JobPrio ioprio_job();
+
+/* for threads that only do background work: the walker, the copy
+ * queue and the sizing queue. nothing runs on the shared libuv pool, so
+ * neither value is ever restored. threads they create inherit both. */
+void ioprio_thread(JobPrio prio);
+
+#endif
@@ -0,0 +1,152 @@
+//fork-join worker pool for splitting loops across cores
+#include <unistd.h>
+#include <uv.h>
+#include "nav/event/pool.h"
+#include "nav/log.h"
+#include "nav/macros.h"
+
+#define POOL_MAX   16
+#define POOL_SLICE 4  /* chunks per thread, evens out slow chunks */
+
+typedef struct {
+  pool_cb cb;
+  void *arg;
+  int count;
+  int chunk;
+  int next;     //next unclaimed index
+  int pending;  //chunks not yet finished
+} Job;
+
+typedef struct {
+  uv_thread_t threads[POOL_MAX];
+  uv_mutex_t lock;
+  uv_cond_t work;
+  uv_cond_t done;
+  int size;
+  bool stop;
+  bool busy;    //a job is running, guarded by lock
+  Job job;
+} Pool;
+static Pool pool;
+
+/* set on pool workers and on a caller while its job runs, so a nested
+ * pool_for runs inline without reading shared state */
+static __thread bool in_pool;
+
+/* lock is held on entry and exit */
+static void run_chunks()
+{
+  Job *job = &pool.job;
+  while (job->cb && job->next < job->count) {
+    int start = job->next;
+    int end = MIN(job->count, start + job->chunk);
+    job->next = end;
+    pool_cb cb = job->cb;
+    void *arg = job->arg;
+
+    uv_mutex_unlock(&pool.lock);
+    cb(arg, start, end);
+    uv_mutex_lock(&pool.lock);
+
+    if (--job->pending == 0)
+      uv_cond_signal(&pool.done);
+  }
+}
+
+static void worker(void *arg)
+{
+  in_pool = true;
+  uv_mutex_lock(&pool.lock);
+  while (!pool.stop) {
+    run_chunks();
+    if (!pool.stop)
+      uv_cond_wait(&pool.work, &pool.lock);
+  }
+  uv_mutex_unlock(&pool.lock);
+}
+
+void pool_init()
+{
+  log_msg("INIT", "pool");
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  /* caller thread takes chunks as well */
+  int size = MIN(POOL_MAX, MAX(1, cpus) - 1);
+
+  uv_mutex_init(&pool.lock);
+  uv_cond_init(&pool.work);
+  uv_cond_init(&pool.done);
+  pool.stop = false;
+  pool.busy = false;
+  pool.size = 0;
+
+  for (int i = 0; i < size; i++) {
+    if (uv_thread_create(&pool.threads[i], worker, NULL)) {
+      log_err("POOL", "thread create failed at %d", i);
+      break;
+    }
+    pool.size++;
+  }
+  log_msg("POOL", "workers: %d", pool.size);
+}
+
+void pool_cleanup()
+{
+  uv_mutex_lock(&pool.lock);
+  pool.stop = true;
+  uv_cond_broadcast(&pool.work);
+  uv_mutex_unlock(&pool.lock);
+
+  for (int i = 0; i < pool.size; i++)
+    uv_thread_join(&pool.threads[i]);
+
+  uv_cond_destroy(&pool.done);
+  uv_cond_destroy(&pool.work);
+  uv_mutex_destroy(&pool.lock);
+  pool.size = 0;
+}
+
+int pool_size()
+{
+  return pool.size + 1;
+}
+
+// split [0, count) into chunks and run cb on each across the pool.
+// returns once every chunk is finished. counts below min, or a nested
+// call from inside a chunk, run inline on the caller.
+void pool_for(int count, int min, pool_cb cb, void *arg)
+{
+  if (count < 1)
+    return;
+
+  if (pool.size < 1 || count < min || in_pool)
+    return cb(arg, 0, count);
+
+  /* another thread's job holds the pool */
+  uv_mutex_lock(&pool.lock);
+  if (pool.busy) {
+    uv_mutex_unlock(&pool.lock);
+    return cb(arg, 0, count);
+  }
+  pool.busy = true;
+  in_pool = true;
+
+  int chunk = MAX(1, count / (pool_size() * POOL_SLICE));
+  pool.job = (Job){
+    .cb = cb,
+    .arg = arg,
+    .count = count,
+    .chunk = chunk,
+    .next = 0,
+    .pending = (count + chunk - 1) / chunk,
+  };
+  uv_cond_broadcast(&pool.work);
+
+  run_chunks();
+  while (pool.job.pending > 0)
+    uv_cond_wait(&pool.done, &pool.lock);
+
+  pool.job.cb = NULL;
+  pool.busy = false;
+  in_pool = false;
+  uv_mutex_unlock(&pool.lock);
+}
@@ -0,0 +1,14 @@
+#ifndef NV_EVENT_POOL_H
+#define NV_EVENT_POOL_H
+
+#include <stdbool.h>
+
+/* called on a worker for the index range [start, end) */
+typedef void (*pool_cb)(void *arg, int start, int end);
+
+void pool_init();
+void pool_cleanup();
+int pool_size();
+void pool_for(int count, int min, pool_cb cb, void *arg);
+
+#endif
@@ -0,0 +1,182 @@
+//parallel recursive delete relative to directory descriptors
+#include <dirent.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <uv.h>
+#include "nav/event/rmtree.h"
+#include "nav/log.h"
+#include "nav/macros.h"
+
+#define RM_MAX  16
+#define RM_OPEN O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC
+
+/* a directory is removed from its parent's fd once its own scan and
+ * every subdirectory are done, so the deepest go first. fd is opened
+ * when the scan starts; queued siblings hold none. */
+typedef struct RmDir RmDir;
+struct RmDir {
+  RmDir *parent;
+  RmDir *next;    //on the stack
+  int fd;
+  int pending;    //own scan plus subdirs left
+  char name[];
+};
+
+typedef struct {
+  uv_thread_t threads[RM_MAX];
+  uv_mutex_t lock;
+  uv_cond_t work;
+  RmDir *stack;
+  int size;       //threads, caller included
+  int max;
+  int busy;       //threads scanning
+  const int *cancel;
+} RmTree;
+
+static void worker(void *arg);
+
+static bool cancelled(RmTree *rt)
+{
+  return __atomic_load_n(rt->cancel, __ATOMIC_RELAXED);
+}
+
+/* lock is held */
+static void spawn(RmTree *rt)
+{
+  if (rt->size >= rt->max || rt->busy < rt->size)
+    return;
+  if (uv_thread_create(&rt->threads[rt->size - 1], worker, rt))
+    rt->max = rt->size;
+  else
+    rt->size++;
+}
+
+static void push(RmTree *rt, RmDir *parent, const char *name)
+{
+  size_t len = strlen(name) + 1;
+  RmDir *dir = malloc(sizeof(RmDir) + len);
+  memcpy(dir->name, name, len);
+  dir->parent = parent;
+  dir->fd = -1;
+  dir->pending = 1;
+  __atomic_add_fetch(&parent->pending, 1, __ATOMIC_RELAXED);
+
+  uv_mutex_lock(&rt->lock);
+  dir->next = rt->stack;
+  rt->stack = dir;
+  spawn(rt);
+  uv_cond_signal(&rt->work);
+  uv_mutex_unlock(&rt->lock);
+}
+
+static void release(RmTree *rt, RmDir *dir)
+{
+  while (dir && __atomic_sub_fetch(&dir->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+    RmDir *parent = dir->parent;
+    if (dir->fd != -1)
+      close(dir->fd);
+    if (parent && !cancelled(rt) &&
+        unlinkat(parent->fd, dir->name, AT_REMOVEDIR) == -1)
+      log_err("RMTREE", "rmdir failed %s", dir->name);
+    free(dir);
+    dir = parent;
+  }
+}
+
+static bool is_dir(int dfd, struct dirent *d)
+{
+  if (d->d_type != DT_UNKNOWN)
+    return d->d_type == DT_DIR;
+  struct stat st;
+  return fstatat(dfd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+    S_ISDIR(st.st_mode);
+}
+
+static void scan(RmTree *rt, RmDir *dir)
+{
+  if (dir->parent)
+    dir->fd = openat(dir->parent->fd, dir->name, RM_OPEN);
+
+  int fd = dir->fd == -1 ? -1 : dup(dir->fd);
+  DIR *dp = fd == -1 ? NULL : fdopendir(fd);
+  if (!dp && fd != -1)
+    close(fd);
+
+  struct dirent *d;
+  while (dp && (d = readdir(dp))) {
+    if (cancelled(rt))
+      break;
+
+    if (strcmp(d->d_name, ".") == 0 ||
+        strcmp(d->d_name, "..") == 0)
+      continue;
+
+    if (is_dir(dir->fd, d))
+      push(rt, dir, d->d_name);
+    else if (unlinkat(dir->fd, d->d_name, 0) == -1)
+      log_err("RMTREE", "unlink failed %s", d->d_name);
+  }
+
+  if (dp)
+    closedir(dp);
+  release(rt, dir);
+}
+
+/* runs until the stack is empty and no scan can refill it */
+static void worker(void *arg)
+{
+  RmTree *rt = arg;
+  uv_mutex_lock(&rt->lock);
+  for (;;) {
+    RmDir *dir = rt->stack;
+    if (dir) {
+      rt->stack = dir->next;
+      rt->busy++;
+      uv_mutex_unlock(&rt->lock);
+      scan(rt, dir);
+      uv_mutex_lock(&rt->lock);
+      rt->busy--;
+      continue;
+    }
+    if (rt->busy == 0)
+      break;
+    uv_cond_wait(&rt->work, &rt->lock);
+  }
+  uv_cond_broadcast(&rt->work);
+  uv_mutex_unlock(&rt->lock);
+}
+
+void rmtree(int fd, int jobs, const int *cancel)
+{
+  if (fd == -1)
+    return;
+
+  RmTree rt = {
+    .size = 1,
+    .max = MIN(RM_MAX, MAX(1, jobs)),
+    .cancel = cancel,
+  };
+  uv_mutex_init(&rt.lock);
+  uv_cond_init(&rt.work);
+
+  /* the extra count keeps the root from being removed */
+  RmDir *root = malloc(sizeof(RmDir) + 1);
+  root->name[0] = '\0';
+  root->parent = NULL;
+  root->next = NULL;
+  root->fd = fd;
+  root->pending = 2;
+  rt.stack = root;
+
+  worker(&rt);
+  for (int i = 0; i < rt.size - 1; i++)
+    uv_thread_join(&rt.threads[i]);
+  release(&rt, root);
+
+  uv_cond_destroy(&rt.work);
+  uv_mutex_destroy(&rt.lock);
+}
@@ -0,0 +1,9 @@
+#ifndef NV_EVENT_RMTREE_H
+#define NV_EVENT_RMTREE_H
+
+/* remove everything below the directory fd across up to jobs threads,
+ * blocking until done. consumes fd; the directory itself is kept.
+ * a nonzero *cancel stops the walk early. */
+void rmtree(int fd, int jobs, const int *cancel);
+
+#endif
@@ -0,0 +1,316 @@
+//XDG trash: move into the trash of the same filesystem, purge old entries
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "nav/event/trash.h"
+#include "nav/event/rmtree.h"
+#include "nav/event/fs.h"
+#include "nav/log.h"
+
+#define INFO_EXT  ".trashinfo"
+#define INFO_DATE "%Y-%m-%dT%H:%M:%S"
+#define INFO_MAX  4096
+
+typedef struct Seen Seen;
+struct Seen {
+  Seen *next;
+  char dir[];
+};
+static Seen *seen;
+
+static int mkpath(char *path, mode_t mode)
+{
+  struct stat st;
+  if (stat(path, &st) == 0)
+    return S_ISDIR(st.st_mode) ? 0 : -1;
+
+  char *p = strrchr(path, '/');
+  if (p && p != path) {
+    *p = '\0';
+    int ret = mkpath(path, mode);
+    *p = '/';
+    if (ret == -1)
+      return -1;
+  }
+  return mkdir(path, mode) == -1 && errno != EEXIST ? -1 : 0;
+}
+
+static bool make_trash(char *dir)
+{
+  char *files = conspath(dir, "files");
+  char *info  = conspath(dir, "info");
+  bool ok = mkpath(files, 0700) == 0 && mkpath(info, 0700) == 0;
+  free(files);
+  free(info);
+  return ok;
+}
+
+static char* home_trash()
+{
+  char *data = getenv("XDG_DATA_HOME");
+  if (data && *data)
+    return conspath(data, "Trash");
+  char *home = getenv("HOME");
+  return home ? conspath(home, ".local/share/Trash") : NULL;
+}
+
+/* highest directory above path on the same device */
+static char* mount_top(const char *path, dev_t dev)
+{
+  char *top = strdup(path);
+  while (strcmp(top, "/")) {
+    char *p = strrchr(top, '/');
+    char save = p[p == top];
+    p[p == top] = '\0';
+
+    struct stat st;
+    if (stat(top, &st) == -1 || st.st_dev != dev) {
+      p[p == top] = save;
+      break;
+    }
+  }
+  return top;
+}
+
+/* $topdir/.Trash/$uid when an admin made .Trash sticky, otherwise
+ * $topdir/.Trash-$uid */
+static char* top_trash(const char *top)
+{
+  char *shared = conspath(top, ".Trash");
+  char uid[32], *dir = NULL;
+  snprintf(uid, sizeof(uid), "%d", getuid());
+
+  struct stat st;
+  if (lstat(shared, &st) == 0 && S_ISDIR(st.st_mode) &&
+      (st.st_mode & S_ISVTX)) {
+    dir = conspath(shared, uid);
+    if (!make_trash(dir)) {
+      free(dir);
+      dir = NULL;
+    }
+  }
+  free(shared);
+  if (dir)
+    return dir;
+
+  char name[48];
+  snprintf(name, sizeof(name), ".Trash-%s", uid);
+  dir = conspath(top, name);
+  if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+    goto fail;
+  if (lstat(dir, &st) == -1 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != getuid() || !make_trash(dir))
+    goto fail;
+  return dir;
+fail:
+  free(dir);
+  return NULL;
+}
+
+static char* url_encode(const char *src)
+{
+  static const char *hex = "0123456789ABCDEF";
+  char *dst = malloc(strlen(src) * 3 + 1), *p = dst;
+  for (const unsigned char *s = (const unsigned char*)src; *s; s++) {
+    if (strchr("/-._~", *s) || (*s < 128 && isalnum(*s)))
+      *p++ = *s;
+    else {
+      *p++ = '%';
+      *p++ = hex[*s >> 4];
+      *p++ = hex[*s & 15];
+    }
+  }
+  *p = '\0';
+  return dst;
+}
+
+/* reserve a name in info/ with O_EXCL, as the spec asks */
+static int open_info(const char *dir, const char *base, char **name)
+{
+  for (int n = 0; n < 1000; n++) {
+    if (n)
+      asprintf(name, "%s.%d", base, n);
+    else
+      *name = strdup(base);
+
+    char *file;
+    asprintf(&file, "%s/info/%s" INFO_EXT, dir, *name);
+    int fd = open(file, O_CREAT|O_EXCL|O_WRONLY|O_CLOEXEC, 0600);
+    free(file);
+    if (fd != -1 || errno != EEXIST)
+      return fd;
+    free(*name);
+  }
+  *name = NULL;
+  return -1;
+}
+
+char* trash_put(const char *path)
+{
+  struct stat st;
+  if (lstat(path, &st) == -1)
+    return NULL;
+
+  int err = 0;
+  /* resolve the parent only, a link is trashed as itself */
+  char *tmp = strdup(path);
+  char *base = strdup(basename(tmp));
+  char *parent = realpath(dirname(tmp), NULL);
+  free(tmp);
+  if (!parent) {
+    err = errno;
+    free(base);
+    errno = err;
+    return NULL;
+  }
+  char *abs = conspath(parent, base);
+
+  char *dir = home_trash();
+  char *rel = abs;
+  struct stat hs;
+  if (dir && (!make_trash(dir) || stat(dir, &hs) == -1 ||
+      hs.st_dev != st.st_dev)) {
+    free(dir);
+    dir = NULL;
+  }
+  if (!dir) {
+    char *top = mount_top(parent, st.st_dev);
+    dir = top_trash(top);
+    rel = abs + strlen(top) + (strcmp(top, "/") != 0);
+    free(top);
+  }
+
+  char *name = NULL;
+  int fd = dir ? open_info(dir, base, &name) : -1;
+  if (fd == -1) {
+    err = dir ? errno : ENOENT;
+    log_err("TRASH", "no trash for %s", abs);
+    goto fail;
+  }
+
+  char date[32];
+  time_t now = time(NULL);
+  strftime(date, sizeof(date), INFO_DATE, localtime(&now));
+  char *url = url_encode(rel);
+  dprintf(fd, "[Trash Info]\nPath=%s\nDeletionDate=%s\n", url, date);
+  free(url);
+  close(fd);
+
+  char *dst, *info;
+  asprintf(&dst, "%s/files/%s", dir, name);
+  asprintf(&info, "%s/info/%s" INFO_EXT, dir, name);
+  int ret = renameat2(AT_FDCWD, abs, AT_FDCWD, dst, RENAME_NOREPLACE);
+  if (ret == -1) {
+    err = errno;
+    log_err("TRASH", "%s: %s", abs, strerror(err));
+    unlink(info);
+  }
+  free(dst);
+  free(info);
+  if (ret == -1)
+    goto fail;
+
+  free(name);
+  free(parent);
+  free(base);
+  free(abs);
+  return dir;
+fail:
+  free(name);
+  free(dir);
+  free(parent);
+  free(base);
+  free(abs);
+  errno = err;
+  return NULL;
+}
+
+bool trash_first(const char *dir)
+{
+  for (Seen *it = seen; it; it = it->next) {
+    if (!strcmp(it->dir, dir))
+      return false;
+  }
+  Seen *it = malloc(sizeof(Seen) + strlen(dir) + 1);
+  strcpy(it->dir, dir);
+  it->next = seen;
+  seen = it;
+  return true;
+}
+
+static time_t info_date(int dfd, const char *file)
+{
+  char buf[INFO_MAX];
+  int fd = openat(dfd, file, O_RDONLY|O_CLOEXEC);
+  if (fd == -1)
+    return -1;
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0)
+    return -1;
+  buf[len] = '\0';
+
+  char *p = strstr(buf, "DeletionDate=");
+  struct tm tm = {0};
+  if (!p || !strptime(p + strlen("DeletionDate="), INFO_DATE, &tm))
+    return -1;
+  tm.tm_isdst = -1;
+  return mktime(&tm);
+}
+
+void trash_purge(const char *dir, time_t before, int jobs, const int *cancel)
+{
+  log_msg("TRASH", "purge %s", dir);
+  char *files = conspath(dir, "files");
+  char *info  = conspath(dir, "info");
+  int ffd = open(files, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+  int ifd = open(info,  O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+  DIR *dp = ifd == -1 ? NULL : fdopendir(dup(ifd));
+
+  struct dirent *d;
+  while (ffd != -1 && dp && (d = readdir(dp))) {
+    if (__atomic_load_n(cancel, __ATOMIC_RELAXED))
+      break;
+
+    size_t len = strlen(d->d_name);
+    if (len <= strlen(INFO_EXT) ||
+        strcmp(d->d_name + len - strlen(INFO_EXT), INFO_EXT))
+      continue;
+
+    time_t date = info_date(ifd, d->d_name);
+    if (date == -1 || date >= before)
+      continue;
+
+    char *name = strndup(d->d_name, len - strlen(INFO_EXT));
+    struct stat st;
+    int ret = fstatat(ffd, name, &st, AT_SYMLINK_NOFOLLOW);
+    if (ret == 0 && S_ISDIR(st.st_mode)) {
+      rmtree(openat(ffd, name, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC),
+          jobs, cancel);
+      ret = unlinkat(ffd, name, AT_REMOVEDIR);
+    }
+    else if (ret == 0)
+      ret = unlinkat(ffd, name, 0);
+
+    /* the info goes last so a failed purge can be retried */
+    if (ret == 0 || errno == ENOENT)
+      unlinkat(ifd, d->d_name, 0);
+    free(name);
+  }
+
+  if (dp)
+    closedir(dp);
+  if (ffd != -1)
+    close(ffd);
+  if (ifd != -1)
+    close(ifd);
+  free(files);
+  free(info);
+}
@@ -0,0 +1,18 @@
+#ifndef NV_EVENT_TRASH_H
+#define NV_EVENT_TRASH_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/* blocking; move path to the XDG trash of its filesystem. returns the
+ * trash directory used, or NULL with errno set when path was left in
+ * place. */
+char* trash_put(const char *path);
+
+/* true the first time a trash directory is seen this session */
+bool trash_first(const char *dir);
+
+/* blocking; remove entries trashed before the cutoff */
+void trash_purge(const char *dir, time_t before, int jobs, const int *cancel);
+
+#endif
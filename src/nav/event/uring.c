@@ -0,0 +1,201 @@
+//batched statx over io_uring, without liburing
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "nav/event/uring.h"
+#include "nav/macros.h"
+
+#if defined(IO_URING_SUPPORTED) && defined(STATX_TYPE)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define RING_SIZE 256
+
+typedef struct {
+  int fd;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map;
+  void *cq_map;
+  size_t sq_len;
+  size_t cq_len;
+  size_t sqe_len;
+} Ring;
+
+static __thread Ring *ring;   //one per threadpool thread, kept for its life
+static bool dead;             //setup or STATX op unsupported, atomic
+
+static void ring_free(Ring *r)
+{
+  if (r->sqes)
+    munmap(r->sqes, r->sqe_len);
+  if (r->cq_map && r->cq_map != r->sq_map)
+    munmap(r->cq_map, r->cq_len);
+  if (r->sq_map)
+    munmap(r->sq_map, r->sq_len);
+  close(r->fd);
+  free(r);
+}
+
+static void* ring_map(int fd, size_t len, off_t off)
+{
+  void *p = mmap(NULL, len, PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_POPULATE, fd, off);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+static Ring* ring_new()
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  int fd = syscall(__NR_io_uring_setup, RING_SIZE, &p);
+  if (fd < 0)
+    return NULL;
+
+  Ring *r = calloc(1, sizeof(Ring));
+  r->fd = fd;
+  r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->sq_len = r->cq_len = MAX(r->sq_len, r->cq_len);
+
+  if (!(r->sq_map = ring_map(fd, r->sq_len, IORING_OFF_SQ_RING)))
+    goto fail;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->cq_map = r->sq_map;
+  else if (!(r->cq_map = ring_map(fd, r->cq_len, IORING_OFF_CQ_RING)))
+    goto fail;
+
+  r->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  if (!(r->sqes = ring_map(fd, r->sqe_len, IORING_OFF_SQES)))
+    goto fail;
+
+  char *sq = r->sq_map;
+  char *cq = r->cq_map;
+  r->sq_tail  = (unsigned*)(sq + p.sq_off.tail);
+  r->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned*)(sq + p.sq_off.array);
+  r->cq_head  = (unsigned*)(cq + p.cq_off.head);
+  r->cq_tail  = (unsigned*)(cq + p.cq_off.tail);
+  r->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+  r->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+  return r;
+fail:
+  ring_free(r);
+  return NULL;
+}
+
+static int reap(int *res)
+{
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  int n = 0;
+  for (; head != tail; head++, n++) {
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    res[cqe->user_data] = cqe->res;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return n;
+}
+
+/* unsubmitted entries still point at the caller's buffers, so the ring
+ * is never entered again. ones already submitted are waited out before
+ * the ring is torn down; if that fails it is left mapped, since the
+ * kernel may still write into the caller's buffers. */
+static void ring_dead(unsigned inflight, int *res)
+{
+  __atomic_store_n(&dead, true, __ATOMIC_RELAXED);
+  while (inflight > 0) {
+    int ret = syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+        IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0 && errno != EINTR)
+      break;
+    inflight -= reap(res);
+  }
+  if (inflight == 0)
+    ring_free(ring);
+  ring = NULL;
+}
+
+int uring_statx(char **paths, int count, int flags, unsigned mask,
+    struct statx *out, int *res)
+{
+  /* rings of other threads are idle between calls */
+  if (__atomic_load_n(&dead, __ATOMIC_RELAXED)) {
+    if (ring)
+      ring_free(ring);
+    ring = NULL;
+    return -1;
+  }
+  if (!ring && !(ring = ring_new())) {
+    __atomic_store_n(&dead, true, __ATOMIC_RELAXED);
+    return -1;
+  }
+
+  for (int done = 0; done < count;) {
+    unsigned n = MIN(count - done, *ring->sq_mask + 1);
+    unsigned tail = *ring->sq_tail;
+
+    for (unsigned i = 0; i < n; i++) {
+      unsigned idx = (tail + i) & *ring->sq_mask;
+      struct io_uring_sqe *sqe = &ring->sqes[idx];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode      = IORING_OP_STATX;
+      sqe->fd          = AT_FDCWD;
+      sqe->addr        = (uintptr_t)paths[done + i];
+      sqe->len         = mask;
+      sqe->off         = (uintptr_t)&out[done + i];
+      sqe->statx_flags = flags;
+      sqe->user_data   = done + i;
+      ring->sq_array[idx] = idx;
+    }
+    __atomic_store_n(ring->sq_tail, tail + n, __ATOMIC_RELEASE);
+
+    unsigned submitted = 0;
+    unsigned reaped = 0;
+    while (reaped < n) {
+      int ret = syscall(__NR_io_uring_enter, ring->fd, n - submitted, 1,
+          IORING_ENTER_GETEVENTS, NULL, 0);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      if (ret < 0) {
+        ring_dead(submitted - reaped, res);
+        return -1;
+      }
+      submitted += ret;
+      reaped += reap(res);
+    }
+
+    /* kernels before 5.6 reject the opcode per entry */
+    for (unsigned i = 0; i < n; i++) {
+      if (res[done + i] == -EINVAL) {
+        ring_dead(0, res);
+        return -1;
+      }
+    }
+    done += n;
+  }
+  return 0;
+}
+
+#else
+
+int uring_statx(char **paths, int count, int flags, unsigned mask,
+    struct statx *out, int *res)
+{
+  return -1;
+}
+
+#endif
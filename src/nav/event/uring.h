@@ -0,0 +1,11 @@
+#ifndef NV_EVENT_URING_H
+#define NV_EVENT_URING_H
+
+struct statx;
+
+/* statx a batch of paths through a per-thread io_uring. res holds each
+ * result or -errno. returns -1 when io_uring is unavailable. */
+int uring_statx(char **paths, int count, int flags, unsigned mask,
+    struct statx *out, int *res);
+
+#endif
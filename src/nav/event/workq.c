@@ -0,0 +1,131 @@
+//request queue served by dedicated threads
+#include <stdbool.h>
+#include <stdlib.h>
+#include <uv.h>
+#include "nav/event/workq.h"
+#include "nav/event/event.h"
+#include "nav/log.h"
+#include "nav/macros.h"
+
+#define WORKQ_MAX 32
+
+struct WorkQ {
+  uv_thread_t threads[WORKQ_MAX];
+  uv_mutex_t lock;    //guards all but pending
+  uv_cond_t work;
+  uv_async_t async;
+  TAILQ_HEAD(WorkReqs, WorkReq) p;
+  struct WorkReqs done;
+  int size;           //threads started
+  int max;            //requests run at once
+  int busy;
+  int queued;
+  int pending;        //pushed and not yet done, loop side
+  bool stop;
+};
+
+static void worker(void *arg)
+{
+  WorkQ *q = arg;
+  uv_mutex_lock(&q->lock);
+  while (!q->stop) {
+    WorkReq *req = TAILQ_FIRST(&q->p);
+    if (!req || q->busy >= q->max) {
+      uv_cond_wait(&q->work, &q->lock);
+      continue;
+    }
+    TAILQ_REMOVE(&q->p, req, ent);
+    q->queued--;
+    q->busy++;
+    uv_mutex_unlock(&q->lock);
+
+    req->work(req);
+
+    uv_mutex_lock(&q->lock);
+    q->busy--;
+    TAILQ_INSERT_TAIL(&q->done, req, ent);
+    uv_async_send(&q->async);
+    /* a thread held back by max may go */
+    uv_cond_signal(&q->work);
+  }
+  uv_mutex_unlock(&q->lock);
+}
+
+static void done_cb(uv_async_t *handle)
+{
+  WorkQ *q = handle->data;
+  struct WorkReqs done = TAILQ_HEAD_INITIALIZER(done);
+  uv_mutex_lock(&q->lock);
+  TAILQ_SWAP(&done, &q->done, WorkReq, ent);
+  uv_mutex_unlock(&q->lock);
+
+  WorkReq *req;
+  while ((req = TAILQ_FIRST(&done))) {
+    TAILQ_REMOVE(&done, req, ent);
+    if (--q->pending == 0)
+      uv_unref((uv_handle_t*)&q->async);
+    req->done(req);
+  }
+}
+
+WorkQ* workq_new(int max)
+{
+  WorkQ *q = calloc(1, sizeof(WorkQ));
+  TAILQ_INIT(&q->p);
+  TAILQ_INIT(&q->done);
+  q->max = MIN(WORKQ_MAX, MAX(1, max));
+  uv_mutex_init(&q->lock);
+  uv_cond_init(&q->work);
+  uv_async_init(eventloop(), &q->async, done_cb);
+  uv_unref((uv_handle_t*)&q->async);
+  q->async.data = q;
+  return q;
+}
+
+static void free_cb(uv_handle_t *handle)
+{
+  free(handle->data);
+}
+
+/* requests still queued are dropped */
+void workq_free(WorkQ *q)
+{
+  uv_mutex_lock(&q->lock);
+  q->stop = true;
+  uv_cond_broadcast(&q->work);
+  uv_mutex_unlock(&q->lock);
+  for (int i = 0; i < q->size; i++)
+    uv_thread_join(&q->threads[i]);
+
+  uv_cond_destroy(&q->work);
+  uv_mutex_destroy(&q->lock);
+  uv_close((uv_handle_t*)&q->async, free_cb);
+}
+
+void workq_size(WorkQ *q, int max)
+{
+  uv_mutex_lock(&q->lock);
+  q->max = MIN(WORKQ_MAX, MAX(1, max));
+  uv_cond_broadcast(&q->work);
+  uv_mutex_unlock(&q->lock);
+}
+
+void workq_push(WorkQ *q, WorkReq *req, workq_cb work, workq_cb done)
+{
+  req->work = work;
+  req->done = done;
+  if (q->pending++ == 0)
+    uv_ref((uv_handle_t*)&q->async);
+
+  uv_mutex_lock(&q->lock);
+  TAILQ_INSERT_TAIL(&q->p, req, ent);
+  q->queued++;
+  if (q->queued > q->size - q->busy && q->size < q->max) {
+    if (uv_thread_create(&q->threads[q->size], worker, q))
+      log_err("WORKQ", "thread create failed at %d", q->size);
+    else
+      q->size++;
+  }
+  uv_cond_signal(&q->work);
+  uv_mutex_unlock(&q->lock);
+}
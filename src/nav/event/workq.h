@@ -0,0 +1,25 @@
+#ifndef NV_EVENT_WORKQ_H
+#define NV_EVENT_WORKQ_H
+
+#include "nav/lib/sys_queue.h"
+
+/* blocking requests on threads of their own, so long work does not
+ * hold the libuv pool that scans need. done runs on the loop. */
+typedef struct WorkReq WorkReq;
+typedef void (*workq_cb)(WorkReq *req);
+struct WorkReq {
+  TAILQ_ENTRY(WorkReq) ent;
+  workq_cb work;
+  workq_cb done;
+  void *data;
+};
+
+typedef struct WorkQ WorkQ;
+
+/* threads are started as work arrives, up to max */
+WorkQ* workq_new(int max);
+void workq_free(WorkQ *q);
+void workq_size(WorkQ *q, int max);
+void workq_push(WorkQ *q, WorkReq *req, workq_cb work, workq_cb done);
+
+#endif
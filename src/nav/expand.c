@@ -8,6 +8,7 @@
 #include "nav/table.h"
 #include "nav/model.h"
 #include "nav/event/fs.h"
+#include "nav/event/file.h"
 #include "nav/tui/select.h"
 
 enum fm_fmt {
@@ -151,6 +152,36 @@ static varg_T stat_type(const char *name)
   return arg;
 }
 
+static varg_T watch_type(const char *name)
+{
+  varg_T arg = {};
+  Buffer *buf = window_get_focus();
+  if (!buf_attached(buf))
+    return arg;
+
+  char *str = fs_watch_info(buf->hndl->key, name);
+  if (!str)
+    return arg;
+
+  arg.argc = 1;
+  arg.argv = malloc(sizeof(char*));
+  arg.argv[0] = str;
+  return arg;
+}
+
+static varg_T job_type(const char *name)
+{
+  varg_T arg = {};
+  char *str = file_job_info(name);
+  if (!str)
+    return arg;
+
+  arg.argc = 1;
+  arg.argv = malloc(sizeof(char*));
+  arg.argv[0] = str;
+  return arg;
+}
+
 static varg_T proc_type(const char *name)
 {
   varg_T arg = {};
@@ -199,6 +230,10 @@ static varg_T get_type(const char *key, const char *alt)
       return op_type(alt);
     case 's':
       return stat_type(alt);
+    case 'w':
+      return watch_type(alt);
+    case 'j':
+      return job_type(alt);
     case '!':
     case '?':
     case '%':
@@ -3,6 +3,12 @@
 #include "nav/model.h"
 #include "nav/tui/buffer.h"
 #include "nav/log.h"
+#include "nav/util.h"
+#include "nav/option.h"
+#include "nav/event/pool.h"
+
+#define FUZZY_CHR '~'
+#define PAR_MIN   20000  /* lines before scoring is split across the pool */
 
 struct Filter {
   Handle *hndl;
@@ -10,6 +16,17 @@ struct Filter {
   char *line;
 };
 
+typedef struct {
+  int score;
+  int idx;
+} Rank;
+
+typedef struct {
+  Model *m;
+  const char *query;
+  int *scores;
+} ScoreJob;
+
 Filter* filter_new(Handle *hndl)
 {
   Filter *fil = malloc(sizeof(Filter));
@@ -28,28 +45,123 @@ void filter_destroy(Handle *hndl)
   free(fil);
 }
 
+static void score_chunk(void *arg, int start, int end)
+{
+  ScoreJob *job = arg;
+  for (int i = start; i < end; i++) {
+    char *str = model_str_line(job->m, i);
+    job->scores[i] = str ? fuzzy_score(str, job->query) : -1;
+  }
+}
+
+/* a ranks below b: lower score, or same score and later in the model */
+static bool rank_worse(Rank *a, Rank *b)
+{
+  return a->score < b->score || (a->score == b->score && a->idx > b->idx);
+}
+
+static int rank_cmp(const void *a, const void *b)
+{
+  return rank_worse((Rank*)a, (Rank*)b) ? 1 : -1;
+}
+
+/* min-heap of the best k ranks, worst on top */
+static void heap_down(Rank *heap, int n, int i)
+{
+  for (;;) {
+    int w = i;
+    int l = 2*i + 1;
+    int r = 2*i + 2;
+    if (l < n && rank_worse(&heap[l], &heap[w]))
+      w = l;
+    if (r < n && rank_worse(&heap[r], &heap[w]))
+      w = r;
+    if (w == i)
+      return;
+    SWAP(Rank, heap[i], heap[w]);
+    i = w;
+  }
+}
+
+static void heap_up(Rank *heap, int i)
+{
+  while (i > 0) {
+    int p = (i - 1) / 2;
+    if (!rank_worse(&heap[i], &heap[p]))
+      return;
+    SWAP(Rank, heap[i], heap[p]);
+    i = p;
+  }
+}
+
+// rank lines by fuzzy score and keep the best 'fuzzymax' of them.
+// returns the number of lines removed.
+static int filter_fuzzy(Model *m, const char *query)
+{
+  int max = model_count(m);
+  uint k = get_opt_uint("fuzzymax");
+  if (k == 0 || k > max)
+    k = max;
+
+  ScoreJob job = {m, query, malloc(MAX(1, max) * sizeof(int))};
+  pool_for(max, PAR_MIN, score_chunk, &job);
+
+  Rank *heap = malloc(MAX(1, k) * sizeof(Rank));
+  int n = 0;
+  for (int i = 0; i < max; i++) {
+    Rank r = {job.scores[i], i};
+    if (r.score < 0)
+      continue;
+    if (n < k) {
+      heap[n] = r;
+      heap_up(heap, n++);
+    }
+    else if (rank_worse(&heap[0], &r)) {
+      heap[0] = r;
+      heap_down(heap, n, 0);
+    }
+  }
+  qsort(heap, n, sizeof(Rank), rank_cmp);
+
+  int *order = (int*)job.scores;
+  for (int i = 0; i < n; i++)
+    order[i] = heap[i].idx;
+  int count = model_filter_rank(m, order, n);
+
+  free(heap);
+  free(job.scores);
+  return count;
+}
+
 void filter_build(Filter *fil, const char *line)
 {
   log_msg("FILTER", "build");
   if (fil->pat)
     regex_pat_delete(fil->pat);
+  fil->pat = NULL;
 
-  fil->pat = regex_pat_new(line);
-  SWAP_ALLOC_PTR(fil->line, strdup(line));
+  /* line may be fil->line itself when reapplied */
+  line = strdup(line);
+  SWAP_ALLOC_PTR(fil->line, (char*)line);
 
   Model *m = fil->hndl->model;
 
   model_clear_filter(m);
 
-  int max = model_count(m);
-  int count = 0;
-  for (int i = max; i > 0; i--) {
-    char *str = model_str_line(m, i-1);
-    if (!regex_match(fil->pat, str)) {
-      model_filter_line(m, i-1);
-      count++;
-    }
+  if (line[0] == FUZZY_CHR) {
+    int count = filter_fuzzy(m, &line[1]);
+    buf_signal_filter(fil->hndl->buf, count);
+    return;
   }
+
+  fil->pat = regex_pat_new(line);
+
+  int max = model_count(m);
+  char *hits = calloc(MAX(1, max), 1);
+  regex_match_lines(fil->pat, m, hits);
+  int count = model_filter_lines(m, hits);
+  free(hits);
+
   buf_signal_filter(fil->hndl->buf, count);
 }
 
@@ -27,6 +27,9 @@ struct Model {
   int plnum;        //prev lnum
   int ptop;         //prev top
   sort_ent sort;    //current sort type
+  bool ranked;      //line order set by filter rank
+  bool streaming;   //lines shown in scan order until the scan ends
+  Ventry *tail;     //last entry read into lines
   int (*sortfn)();
   UT_array *lines;
 };
@@ -40,11 +43,12 @@ typedef struct Sort_T Sort_T;
 static struct Sort_T {
   char *key;
   int (*cmp)();
+  bool stat;        //compares stat fields
 } sort_tbl[] = {
-  {"name",   cmp_str},
-  {"ctime",  cmp_time},
-  {"size",   cmp_size},
-  {"type",   cmp_type},
+  {"name",   cmp_str,  false},
+  {"ctime",  cmp_time, true},
+  {"size",   cmp_size, true},
+  {"type",   cmp_type, false},
 };
 
 static int cmp_time(TblRec *r1, TblRec *r2)
@@ -188,6 +192,8 @@ void model_close(Handle *hndl)
   Model *m = hndl->model;
   model_save(m);
   m->blocking = true;
+  m->streaming = false;
+  m->tail = NULL;
   utarray_clear(m->lines);
 }
 
@@ -298,6 +304,7 @@ void model_set_sort(Model *m, char *key, bool rev)
     if (!strcmp(key, sort_tbl[i].key)) {
       m->sort.i = i;
       m->sort.rev = rev;
+      m->ranked = false;
       break;
     }
   }
@@ -310,12 +317,26 @@ void model_sort(Model *m)
   if (!m->blocking)
     model_set_prev(m);
 
-  utarray_sort(m->lines, m->sortfn, &m->sort);
+  if (!m->ranked)
+    utarray_sort(m->lines, m->sortfn, &m->sort);
   refind_line(m);
   refit(m, m->hndl->buf);
   buf_full_invalidate(m->hndl->buf, m->ptop, m->plnum);
 }
 
+// stat fields were filled in after the lines were read. sorting is only
+// redone if the order depends on them.
+void model_stat_fill(Model *m, bool retype)
+{
+  log_msg("MODEL", "model_stat_fill");
+  if (m->blocking)
+    return;
+
+  if (retype || sort_tbl[m->sort.i].stat)
+    return model_sort(m);
+  buf_refresh(m->hndl->buf);
+}
+
 void model_flush(Handle *hndl, bool reopen)
 {
   log_msg("MODEL", "model_flush");
@@ -329,13 +350,15 @@ void model_flush(Handle *hndl, bool reopen)
   model_set_prev(m);
   utarray_clear(m->lines);
   m->blocking = true;
+  m->streaming = false;
+  m->tail = NULL;
 }
 
 void model_recv(Model *m)
 {
   log_msg("MODEL", "model_recv");
   log_msg("MODEL", "block? %d", m->blocking);
-  if (!m->blocking)
+  if (!m->blocking && !m->streaming)
     return;
 
   Handle *h = m->hndl;
@@ -346,11 +369,77 @@ void model_recv(Model *m)
   if (l && !h->key[0])
     return model_full_entry(m, l);
 
+  if (m->streaming)
+    return model_stream_end(m);
+
   Ventry *head = lis_get_val(l, h->key_fld);
 
   model_read_entry(h->model, l, head);
 }
 
+/* entries are appended at the tail of a value's list, so while a scan
+ * only commits, everything after the last line read is new. */
+static void stream_lines(Model *m)
+{
+  Ventry *it = m->tail ? m->tail->next : m->head;
+  if (m->tail && it == m->head)
+    return;
+  do {
+    nv_line ln = { .rec = it->rec };
+    utarray_push_back(m->lines, &ln);
+    m->tail = it;
+    it = it->next;
+  } while (it != m->head);
+}
+
+// show the records committed so far, unsorted, while a scan runs.
+// model_recv sorts the full set once the scan completes.
+void model_stream(Model *m)
+{
+  log_msg("MODEL", "model_stream");
+  if (!m->blocking && !m->streaming)
+    return;
+
+  Handle *h = m->hndl;
+  TblLis *l = fnd_lis(h->tn, h->key_fld, h->key);
+  if (!l->rec || !h->key[0])
+    return;
+
+  if (!m->streaming) {
+    Ventry *head = lis_get_val(l, h->key_fld);
+    if (!m->pfval) {
+      m->pfval = strdup(l->fval);
+      m->ptop = l->index;
+      m->plnum = l->lnum;
+    }
+    m->head = ent_head(head);
+    m->cur = head->rec;
+    m->lis = l;
+    m->streaming = true;
+    m->blocking = false;
+    stream_lines(m);
+    refit(m, h->buf);
+    buf_full_invalidate(h->buf, m->ptop, m->plnum);
+  }
+  else {
+    stream_lines(m);
+    buf_refresh(h->buf);
+  }
+  buf_update_scan(h->buf, model_count(m));
+}
+
+void model_stream_end(Model *m)
+{
+  log_msg("MODEL", "model_stream_end");
+  Handle *h = m->hndl;
+  stream_lines(m);
+  m->streaming = false;
+  m->tail = NULL;
+  buf_update_scan(h->buf, -1);
+  filter_apply(h);
+  model_sort(m);
+}
+
 static void generate_lines(Model *m)
 {
   /* generate hash set of index,line. */
@@ -359,6 +448,7 @@ static void generate_lines(Model *m)
     nv_line ln;
     ln.rec = it->rec;
     utarray_push_back(m->lines, &ln);
+    m->tail = it;
     it = it->next;
   }
 }
@@ -371,6 +461,10 @@ void model_null_entry(Model *m, TblLis *lis)
   m->cur = NULL;
   lis->index = 0;
   lis->lnum = 0;
+  if (m->streaming)
+    buf_update_scan(h->buf, -1);
+  m->streaming = false;
+  m->tail = NULL;
   buf_full_invalidate(h->buf, lis->index, lis->lnum);
   m->blocking = false;
 }
@@ -454,13 +548,47 @@ void model_set_curs(Model *m, int index)
 void model_clear_filter(Model *m)
 {
   log_msg("MODEL", "clear filter");
+  m->ranked = false;
   utarray_clear(m->lines);
   generate_lines(m);
 }
 
-void model_filter_line(Model *m, int index)
+// drop every line whose keep byte is unset in a single pass.
+// returns the number of lines removed.
+int model_filter_lines(Model *m, char *keep)
 {
-  utarray_erase(m->lines, index, 1);
+  int max = utarray_len(m->lines);
+  int n = 0;
+  for (int i = 0; i < max; i++) {
+    if (!keep[i])
+      continue;
+    if (n != i) {
+      nv_line *ln = (nv_line*)utarray_eltptr(m->lines, i);
+      *(nv_line*)utarray_eltptr(m->lines, n) = *ln;
+    }
+    n++;
+  }
+  utarray_resize(m->lines, n);
+  return max - n;
+}
+
+// replace lines with the n lines at indices order, in that order.
+// sorting is suspended until the filter is cleared or the sort changes.
+// returns the number of lines removed.
+int model_filter_rank(Model *m, int *order, int n)
+{
+  int max = utarray_len(m->lines);
+  nv_line *keep = malloc(MAX(1, n) * sizeof(nv_line));
+  for (int i = 0; i < n; i++)
+    keep[i] = *(nv_line*)utarray_eltptr(m->lines, order[i]);
+
+  utarray_clear(m->lines);
+  for (int i = 0; i < n; i++)
+    utarray_push_back(m->lines, &keep[i]);
+
+  free(keep);
+  m->ranked = true;
+  return max - n;
 }
 
 char* model_str_expansion(char *val, char *key)
@@ -14,8 +14,11 @@ bool model_blocking(Handle *hndl);
 void model_ch_focus(Handle *);
 void model_set_sort(Model *m, char *, bool);
 void model_sort(Model *m);
+void model_stat_fill(Model *m, bool retype);
 void model_flush(Handle *, bool);
 void model_recv(Model *m);
+void model_stream(Model *m);
+void model_stream_end(Model *m);
 void refind_line(Model *m);
 
 void model_read_entry(Model *m, TblLis *lis, Ventry *head);
@@ -28,7 +31,8 @@ void* model_curs_value(Model *m, const char *fld);
 TblRec* model_rec_line(Model *m, int index);
 
 void model_clear_filter(Model *m);
-void model_filter_line(Model *m, int);
+int model_filter_lines(Model *m, char *keep);
+int model_filter_rank(Model *m, int *order, int n);
 
 void model_set_curs(Model *m, int index);
 int model_count(Model *m);
@@ -12,12 +12,14 @@
 #include "nav/tui/window.h"
 #include "nav/tui/ex_cmd.h"
 #include "nav/event/event.h"
+#include "nav/event/pool.h"
 #include "nav/event/input.h"
 #include "nav/tui/history.h"
 #include "nav/table.h"
 #include "nav/compl.h"
 #include "nav/event/hook.h"
 #include "nav/event/shell.h"
+#include "nav/event/fs.h"
 #include "nav/event/file.h"
 #include "nav/vt/vt.h"
 
@@ -44,6 +46,7 @@ void init(int debug, char *config_path)
   option_init();
   tables_init();
   event_init();
+  pool_init();
   input_init();
   compl_init();
   hook_init();
@@ -71,6 +74,7 @@ void cleanup(void)
   hook_cleanup();
   compl_cleanup();
   input_cleanup();
+  pool_cleanup();
   event_cleanup();
   tables_cleanup();
   option_cleanup();
@@ -145,5 +149,6 @@ int main(int argc, char **argv)
   start_event_loop();
   DO_EVENTS_UNTIL(!mainloop_busy());
   config_write_info();
+  fs_cache_save();
   cleanup();
 }
@@ -11,6 +11,7 @@
 
 static const char *default_groups[] = {
   [BUF_DIR]              = "BufDir",
+  [BUF_SEARCH]           = "BufSearch",
   [BUF_SEL_ACTIVE]       = "BufSelActive",
   [BUF_SEL_INACTIVE]     = "BufSelInactive",
   [BUF_STDERR]           = "BufStderr",
@@ -36,12 +37,25 @@ static const char *default_groups[] = {
 
 static uint history = 50;
 static uint jumplist = 20;
+static uint fuzzymax = 1000;
+static uint copy_jobs = 8;
+static uint dev_jobs = 4;
+static uint trash_days = 30;
+static uint io_level = 7;
+static uint job_nice = 10;
 static int menu_rows = 5;
 static int default_syn_color;
 static char *hintskey = "wasgd";
 static char *p_sh = "/bin/sh";
 static bool sort_inherit = true;
 static bool sort_reverse = false;
+static bool lazy_stat = false;
+static bool stat_sync = true;
+static char *watch_pol = "adaptive";
+static char *dir_cache = "$HOME/.navcache";
+static char *delete_mode = "unlink";
+static char *io_class = "besteffort";
+static char *copy_rate = "";
 static bool ask_delete = true;
 static bool ask_rename = true;
 char *p_rm = "rm -r";
@@ -57,6 +71,12 @@ static struct nv_option {
 } default_options[] = {
   {"history",       OPTION_UINT,      &history},
   {"jumplist",      OPTION_UINT,      &jumplist},
+  {"fuzzymax",      OPTION_UINT,      &fuzzymax},
+  {"copyjobs",      OPTION_UINT,      &copy_jobs},
+  {"devjobs",       OPTION_UINT,      &dev_jobs},
+  {"trashdays",     OPTION_UINT,      &trash_days},
+  {"iolevel",       OPTION_UINT,      &io_level},
+  {"jobnice",       OPTION_UINT,      &job_nice},
   {"menu_rows",     OPTION_INT,       &menu_rows},
   {"hintkeys",      OPTION_STRING,    &hintskey},
   {"shell",         OPTION_STRING,    &p_sh},
@@ -64,7 +84,14 @@ static struct nv_option {
   {"sortfield",     OPTION_STRING,    &sort_field},
   {"sortinherit",   OPTION_BOOLEAN,   &sort_inherit},
   {"sortreverse",   OPTION_BOOLEAN,   &sort_reverse},
+  {"lazystat",      OPTION_BOOLEAN,   &lazy_stat},
+  {"statsync",      OPTION_BOOLEAN,   &stat_sync},
+  {"watchpolicy",   OPTION_STRING,    &watch_pol},
+  {"dircache",      OPTION_STRING,    &dir_cache},
   {"askdelete",     OPTION_BOOLEAN,   &ask_delete},
+  {"deletemode",    OPTION_STRING,    &delete_mode},
+  {"ioclass",       OPTION_STRING,    &io_class},
+  {"copyrate",      OPTION_STRING,    &copy_rate},
   {"askrename",     OPTION_BOOLEAN,   &ask_rename},
   {"copy-pipe",     OPTION_STRING,    &p_xc},
 };
@@ -349,7 +376,7 @@ void set_opt(const char *name, const char *val, int tgl)
       else if (!strcmp("false", val)) tgl = false;
       else return;
     }
-    *(uint*)opt->value = tgl;
+    *(bool*)opt->value = tgl;
   }
 
   send_hook_msg(EVENT_OPTION_SET, focus_plugin(), NULL,
@@ -380,11 +407,20 @@ int get_opt_int(const char *name)
   if (opt && opt->type == OPTION_INT)
     return *(int*)opt->value;
   else if (opt && opt->type == OPTION_BOOLEAN)
-    return *(int*)opt->value;
+    return *(bool*)opt->value;
   else
     return 0;
 }
 
+bool get_opt_bool(const char *name)
+{
+  nv_option *opt = get_opt(name);
+  if (opt && opt->type == OPTION_BOOLEAN)
+    return *(bool*)opt->value;
+  else
+    return false;
+}
+
 void options_list()
 {
   log_msg("INFO", "setting_list");
@@ -399,7 +435,7 @@ void options_list()
       else if (it->type == OPTION_INT || it->type == OPTION_UINT)
         compl_set_col(i, "%d", *(int*)it->value);
       else if (it->type == OPTION_BOOLEAN)
-        compl_set_col(i, "%s", *(int*)it->value ? "true" : "false");
+        compl_set_col(i, "%s", *(bool*)it->value ? "true" : "false");
       i++;
     }
   }
@@ -55,6 +55,7 @@ struct nv_module {
 
 enum nv_color_group {
   BUF_DIR,
+  BUF_SEARCH,
   BUF_SEL_ACTIVE,
   BUF_SEL_INACTIVE,
   BUF_STDERR,
@@ -104,6 +105,7 @@ void set_opt(const char *, const char *, int);
 char* get_opt_str(const char *);
 uint get_opt_uint(const char *);
 int get_opt_int(const char *);
+bool get_opt_bool(const char *);
 void options_list();
 void groups_list();
 
@@ -123,7 +123,7 @@ static void fm_ch_dir(void **args)
   Plugin *plugin = args[0];
   FM *self = plugin->top;
   char *path = args[1];
-  uv_stat_t *stat = args[2];
+  struct stat *stat = args[2];
 
   if (!stat) {
     nv_err("not a valid path: %s", path);
@@ -147,25 +147,8 @@ static void fm_req_dir(Plugin *plugin, Plugin *caller, HookArg *hka)
   if (!req)
     req = "~";
 
-  DO_EVENTS_UNTIL(!fs_blocking(self->fs));
-
-  char *trypath = add_quotes(req);
-  char *path = fs_trypath(trypath);
-  if (!path) {
-    free(path);
-    path = fs_trypath(req);
-  }
-
-  //NOTE: files could potentially be opened at this stage from their extension.
-  //      the extra FS operations cause extra delay, especially noticeable on
-  //      slow networks. could possibly resolve entering an unresponsive state.
-  if (path)
-    fs_read(self->fs, path);
-  else
-    nv_err("not a valid path: %s", req);
-
-  free(trypath);
-  free(path);
+  /* resolved off the loop; fm_ch_dir reports an invalid path */
+  fs_read(self->fs, req);
 }
 
 static void fm_left(Plugin *host, Plugin *caller, HookArg *hka)
@@ -189,6 +172,24 @@ static void fm_right(Plugin *host, Plugin *caller, HookArg *hka)
   fm_req_dir(host, NULL, &(HookArg){NULL,path});
 }
 
+static void fm_prefetch(Plugin *host, Plugin *caller, HookArg *hka)
+{
+  FM *self = host->top;
+  Model *m = host->hndl->model;
+
+  /* the cursor is only meaningful once lines are read */
+  char *child = NULL;
+  struct stat *st = NULL;
+  if (model_count(m) > 0)
+    st = model_curs_value(m, "stat");
+  if (st && S_ISDIR(st->st_mode))
+    child = model_curs_value(m, "fullpath");
+
+  char *parent = fs_parent_dir(strdup(self->cur_dir));
+  fs_prefetch(child, parent);
+  free(parent);
+}
+
 static void fm_jump(Plugin *plugin, Plugin *caller, HookArg *hka)
 {
   log_msg("WINDOW", "fm_jump");
@@ -293,14 +294,8 @@ void fm_new(Plugin *plugin, Buffer *buf, char *arg)
   fm->base = plugin;
   plugin->fmt_name = "FM";
 
-  /* check manually because won't be initialized to use req_dir */
-  char *path = fs_trypath(arg);
-  if (path)
-    fm->cur_dir = path;
-  else {
-    nv_err("not a valid path: %s", arg);
-    fm->cur_dir = strdup(fs_pwd());
-  }
+  /* opens on the working dir until arg resolves off the loop */
+  fm->cur_dir = strdup(fs_pwd());
 
   jump_init(fm);
   init_fm_hndl(fm, buf, plugin, fm->cur_dir);
@@ -314,13 +309,14 @@ void fm_new(Plugin *plugin, Buffer *buf, char *arg)
   hook_add_intl(buf->id, plugin, plugin, fm_right,   EVENT_RIGHT );
   hook_add_intl(buf->id, plugin, plugin, fm_req_dir, EVENT_OPEN  );
   hook_add_intl(buf->id, plugin, plugin, fm_jump,    EVENT_JUMP  );
+  hook_add_intl(buf->id, plugin, plugin, fm_prefetch, EVENT_CURSOR_CHANGE);
+  hook_add_intl(buf->id, plugin, plugin, fm_prefetch, EVENT_DIROPEN);
   hook_add_intl(buf->id, plugin, NULL,   opt_cb,     EVENT_OPTION_SET);
 
   fm->fs = fs_init(plugin->hndl);
   fm->fs->stat_cb = fm_ch_dir;
   fm->fs->data = plugin;
-  fm_req_dir(plugin, NULL, &(HookArg){NULL,fm->cur_dir});
-  fs_cwd(fm->cur_dir);
+  fm_req_dir(plugin, NULL, &(HookArg){NULL, arg ? arg : fm->cur_dir});
 }
 
 void fm_delete(Plugin *plugin)
@@ -328,7 +324,6 @@ void fm_delete(Plugin *plugin)
   log_msg("FM", "delete");
   FM *fm = plugin->top;
   Handle *h = plugin->hndl;
-  DO_EVENTS_UNTIL(!fs_blocking(fm->fs));
   jump_cleanup(fm);
   model_close(h);
   model_cleanup(h);
@@ -0,0 +1,160 @@
+#include "nav/plugins/jobs/jobs.h"
+#include "nav/tui/buffer.h"
+#include "nav/tui/window.h"
+#include "nav/tui/message.h"
+#include "nav/event/file.h"
+#include "nav/log.h"
+#include "nav/cmdline.h"
+#include "nav/cmd.h"
+#include "nav/table.h"
+#include "nav/model.h"
+
+static Jobs jobs;
+
+void jobs_init()
+{
+  log_msg("JOBS", "init");
+  if (tbl_mk("jobs")) {
+    tbl_mk_fld("jobs", "id",   TYP_STR);
+    tbl_mk_fld("jobs", "line", TYP_STR);
+  }
+  Handle *hndl = malloc(sizeof(Handle));
+  hndl->tn = "jobs";
+  hndl->key_fld = "line";
+  hndl->key = "";
+  hndl->fname = "line";
+  hndl->kname = "id";
+  jobs.hndl = hndl;
+}
+
+/* the model lets go of its lines before any record is deleted */
+static void jobs_flush()
+{
+  if (jobs.opened)
+    model_flush(jobs.hndl, true);
+}
+
+static void jobs_signal_model()
+{
+  if (!jobs.opened)
+    return;
+  Handle *h = jobs.hndl;
+  model_recv(h->model);
+  buf_move(h->buf, 0, 0);
+}
+
+/* the job under the cursor in a jobs buffer, else the first queued */
+static int jobs_target(const char *idstr)
+{
+  int id;
+  if (str_num(idstr, &id))
+    return id;
+
+  Plugin *plugin = window_get_plugin();
+  if (plugin && plugin->top == &jobs) {
+    char *val = model_curs_value(jobs.hndl->model, "id");
+    if (str_num(val, &id))
+      return id;
+  }
+  return file_job_first();
+}
+
+static void jobs_cancel(Plugin *plugin)
+{
+  file_job_cancel(jobs_target(NULL));
+}
+
+void jobs_new(Plugin *plugin, Buffer *buf, char *arg)
+{
+  log_msg("JOBS", "new");
+
+  jobs.base = plugin;
+  plugin->top = &jobs;
+  plugin->fmt_name = "JOBS";
+  plugin->_cancel = jobs_cancel;
+
+  Handle *hndl = jobs.hndl;
+  hndl->buf = buf;
+  plugin->hndl = hndl;
+  model_init(hndl);
+  model_open(hndl);
+
+  buf_set_plugin(buf, plugin, SCR_SIMPLE);
+  buf_set_status(buf, 0, hndl->tn, 0);
+  jobs.opened = true;
+  jobs_flush();
+  jobs_signal_model();
+}
+
+void jobs_delete(Plugin *plugin)
+{
+  jobs.opened = false;
+  Handle *h = plugin->hndl;
+  model_close(h);
+  model_cleanup(h);
+}
+
+void jobs_update(int id, const char *line)
+{
+  char idstr[16];
+  snprintf(idstr, sizeof(idstr), "%d", id);
+  jobs_flush();
+  tbl_del_val("jobs", "id", idstr);
+
+  trans_rec *r = mk_trans_rec(tbl_fld_count("jobs"));
+  edit_trans(r, "id",   idstr,        NULL);
+  edit_trans(r, "line", (char*)line,  NULL);
+  commit((void*[]){"jobs", r});
+  jobs_signal_model();
+}
+
+/* job {pause|resume|cancel} [id], job prio {n} [id] */
+Cmdret jobs_ctl(List *args, Cmdarg *ca)
+{
+  log_msg("JOBS", "ctl");
+  char *act = list_arg(args, 1, VAR_STRING);
+  if (!act) {
+    nv_err("job: missing action");
+    return NORET;
+  }
+
+  int prio = 0;
+  int next = 2;
+  if (!strcmp(act, "prio")) {
+    char *arg = list_arg(args, next++, VAR_STRING);
+    if (!str_num(arg, &prio)) {
+      nv_err("job prio: invalid priority %s", arg ? arg : "");
+      return NORET;
+    }
+  }
+
+  int id = jobs_target(list_arg(args, next, VAR_STRING));
+  bool ok = false;
+  if (!strcmp(act, "pause"))
+    ok = file_job_pause(id, true);
+  else if (!strcmp(act, "resume"))
+    ok = file_job_pause(id, false);
+  else if (!strcmp(act, "cancel"))
+    ok = file_job_cancel(id);
+  else if (!strcmp(act, "prio"))
+    ok = file_job_prio(id, prio);
+  else {
+    nv_err("job: unknown action %s", act);
+    return NORET;
+  }
+
+  if (!ok && !id)
+    nv_err("job %s: no jobs", act);
+  else if (!ok)
+    nv_err("job %s: no job %d", act, id);
+  return NORET;
+}
+
+void jobs_remove(int id)
+{
+  char idstr[16];
+  snprintf(idstr, sizeof(idstr), "%d", id);
+  jobs_flush();
+  tbl_del_val("jobs", "id", idstr);
+  jobs_signal_model();
+}
@@ -0,0 +1,22 @@
+#ifndef NV_PLUGINS_JOBS_H
+#define NV_PLUGINS_JOBS_H
+
+#include "nav/plugins/plugin.h"
+
+typedef struct Jobs Jobs;
+
+struct Jobs {
+  Plugin *base;
+  Handle *hndl;
+  bool opened;
+};
+
+void jobs_init();
+void jobs_new(Plugin *plugin, Buffer *buf, char *arg);
+void jobs_delete(Plugin *plugin);
+
+void jobs_update(int id, const char *line);
+void jobs_remove(int id);
+Cmdret jobs_ctl();
+
+#endif
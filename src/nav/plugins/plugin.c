@@ -5,6 +5,7 @@
 #include "nav/plugins/img/img.h"
 #include "nav/plugins/term/term.h"
 #include "nav/plugins/out/out.h"
+#include "nav/plugins/jobs/jobs.h"
 #include "nav/plugins/dt/dt.h"
 #include "nav/plugins/ed/ed.h"
 #include "nav/compl.h"
@@ -34,6 +35,7 @@ static struct plugin_ent {
   {"fm",   fm_init,  fm_new,   fm_delete,   0},
   {"op",   NULL,     op_new,   op_delete,   1},
   {"out",  out_init, out_new,  out_delete,  0},
+  {"jobs", jobs_init, jobs_new, jobs_delete, 0},
 #if W3M_SUPPORTED
   {"img",  NULL,     img_new,  img_delete,  0},
 #endif
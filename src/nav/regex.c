@@ -1,12 +1,20 @@
 #include <pcre.h>
 #include "nav/lib/utarray.h"
+#include "nav/lib/sys_queue.h"
 
 #include "nav/tui/buffer.h"
 #include "nav/regex.h"
 #include "nav/log.h"
 #include "nav/model.h"
+#include "nav/event/event.h"
+#include "nav/event/pool.h"
 
-#define NSUBEXP  5
+#define NSUBEXP    5
+#define PAR_MIN    20000  /* lines before matching is split across the pool */
+#define STEP_LINES 32768  /* most lines matched per slice of a running search */
+#define STEP_MIN   256    /* fewest lines per slice, for slow patterns */
+#define STEP_MS    8      /* time budget of one search step */
+#define NSPANS     4      /* highlighted matches kept per line */
 
 struct Pattern {
   pcre *pcre;
@@ -15,29 +23,72 @@ struct Pattern {
 
 struct LineMatch {
   UT_array *lines;
+  UT_array *spans; //MatchSpan of every match, ordered by line
   Handle *hndl;
   int pivot_top;
   int pivot_lnum;
   char *gcomp;
+  Pattern *pat;   //set while a search is running
+  int next;       //next line to scan
+  int slice;      //lines per slice, sized from the last one's time
+  MatchSpan *slots; //NSPANS per slice line, held while searching
+  int cur;        //index of focused match
+  bool hover;     //focus the nearest match once found
+  LIST_ENTRY(LineMatch) ent;
 };
 
+typedef struct {
+  Model *m;
+  Pattern *pat;
+  char *hits;        //match count per line
+  MatchSpan *spans;  //NSPANS slots per line, or NULL
+  bool nonempty;     //span only non-empty matches
+  int base;          //line of hits[0]
+} MatchJob;
+
+static const UT_icd span_icd = {sizeof(MatchSpan),NULL,NULL,NULL};
+
 static char* gcomp; /* shared regex for all buffers */
 static int gregsign;
 
+/* searches still counting matches in the background */
+static LIST_HEAD(Searches, LineMatch) searches;
+static uv_idle_t search_idle;
+static bool search_idle_init;
+
 LineMatch* regex_new(Handle *hndl)
 {
   LineMatch *lm = malloc(sizeof(LineMatch));
   memset(lm, 0, sizeof(LineMatch));
   lm->hndl = hndl;
+  lm->cur = -1;
   utarray_new(lm->lines, &ut_int_icd);
+  utarray_new(lm->spans, &span_icd);
   return lm;
 }
 
+static void search_stop(LineMatch *lm)
+{
+  if (!lm->pat)
+    return;
+
+  LIST_REMOVE(lm, ent);
+  regex_pat_delete(lm->pat);
+  lm->pat = NULL;
+  free(lm->slots);
+  lm->slots = NULL;
+  if (LIST_EMPTY(&searches))
+    uv_idle_stop(&search_idle);
+}
+
 void regex_destroy(Handle *hndl)
 {
   LineMatch *lm = hndl->buf->matches;
+  search_stop(lm);
   if (lm->lines)
     utarray_free(lm->lines);
+  if (lm->spans)
+    utarray_free(lm->spans);
   free(lm);
 }
 
@@ -84,12 +135,213 @@ int regex_match_count(LineMatch *lm)
   return utarray_len(lm->lines);
 }
 
+static int exec_line(Pattern *pat, const char *subject, int len, int ofs,
+    int *substr)
+{
+  int ret = pcre_exec(pat->pcre,
+      pat->extra,
+      subject,
+      len,              // length of string
+      ofs,              // Start looking at this point
+      0,                // OPTIONS
+      substr,
+      NSUBEXP);         // Length of substr
+  if (ret == 0)
+    ret = NSUBEXP / 3;
+  return ret;
+}
+
+// count matches of subject, storing up to NSPANS of them in slot.
+// a line whose only matches are empty, as for ^$ or \b, still hits,
+// with a single zero length span that the search does not keep.
+static int line_hit(MatchJob *job, const char *subject, MatchSpan *slot)
+{
+  if (!subject)
+    return 0;
+
+  int substr[NSUBEXP];
+  int len = strlen(subject);
+  int ofs = 0;
+  int n = 0;
+  bool empty = false;
+
+  while (n < NSPANS && ofs <= len) {
+    if (exec_line(job->pat, subject, len, ofs, substr) < 0)
+      break;
+    if (!job->nonempty)
+      return 1;
+
+    int so = substr[0];
+    int eo = substr[1];
+    if (eo <= so) {
+      empty = true;
+      ofs = eo + 1;
+      continue;
+    }
+    if (!slot)
+      return 1;
+
+    slot[n++] = (MatchSpan){.so = so, .len = eo - so};
+    ofs = eo;
+  }
+  if (n == 0 && empty) {
+    if (slot)
+      slot[n] = (MatchSpan){.so = 0, .len = 0};
+    return 1;
+  }
+  return n;
+}
+
+static void match_chunk(void *arg, int start, int end)
+{
+  MatchJob *job = arg;
+  for (int i = start; i < end; i++) {
+    MatchSpan *slot = job->spans ? &job->spans[i*NSPANS] : NULL;
+    job->hits[i] = line_hit(job, model_str_line(job->m, job->base + i), slot);
+  }
+}
+
+static void match_lines(MatchJob *job, int count)
+{
+  pool_for(count, PAR_MIN, match_chunk, job);
+}
+
+// mark hits[i] for every model line matching pat.
+// hits must hold model_count(m) bytes.
+void regex_match_lines(Pattern *pat, Model *m, char *hits)
+{
+  MatchJob job = {m, pat, hits, NULL, false, 0};
+  match_lines(&job, model_count(m));
+}
+
+static void signal_matches(LineMatch *lm)
+{
+  Buffer *buf = lm->hndl->buf;
+  buf_signal_matches(buf, lm->cur, regex_match_count(lm), lm->pat != NULL);
+}
+
+// match the next slices of a running search until the time budget is spent.
+// each slice is sized to half the budget at the rate of the one before, so
+// a slow pattern cannot hold the loop for a whole STEP_LINES slice.
+// returns the number of matches found.
+static int search_step(LineMatch *lm)
+{
+  char hits[STEP_LINES];
+  MatchSpan *slots = lm->slots;
+  Model *m = lm->hndl->model;
+  int max = model_count(m);
+  int found = 0;
+  uint64_t before = os_hrtime();
+
+  while (lm->next < max) {
+    int count = MIN(max - lm->next, lm->slice);
+    uint64_t start = os_hrtime();
+    MatchJob job = {m, lm->pat, hits, slots, true, lm->next};
+    match_lines(&job, count);
+
+    for (int i = 0; i < count; i++) {
+      if (!hits[i])
+        continue;
+      int line = lm->next + i;
+      utarray_push_back(lm->lines, &line);
+      for (int j = 0; j < hits[i]; j++) {
+        MatchSpan *span = &slots[i*NSPANS + j];
+        if (!span->len)
+          continue;
+        span->line = line;
+        utarray_push_back(lm->spans, span);
+      }
+      found++;
+    }
+    lm->next += count;
+
+    uint64_t now = os_hrtime();
+    uint64_t fit = count * STEP_MS * 500000ULL / MAX(now - start, 1);
+    lm->slice = MIN(MAX(fit, STEP_MIN), STEP_LINES);
+    if ((now - before)/1000000 >= STEP_MS)
+      break;
+  }
+
+  if (lm->next >= max)
+    search_stop(lm);
+  if (lm->hover && (found || !lm->pat))
+    regex_hover(lm);
+  if (found)
+    buf_refresh(lm->hndl->buf);
+
+  signal_matches(lm);
+  return found;
+}
+
+static void search_idle_cb(uv_idle_t *handle)
+{
+  LineMatch *it, *tmp;
+  LIST_FOREACH_SAFE(it, &searches, ent, tmp)
+    search_step(it);
+}
+
+static void search_start(LineMatch *lm, Pattern *pat)
+{
+  if (!search_idle_init) {
+    uv_idle_init(eventloop(), &search_idle);
+    search_idle_init = true;
+  }
+
+  lm->pat = pat;
+  lm->next = 0;
+  lm->slice = STEP_MIN;
+  if (!lm->slots)
+    lm->slots = malloc(STEP_LINES * NSPANS * sizeof(MatchSpan));
+  LIST_INSERT_HEAD(&searches, lm, ent);
+
+  /* first slice runs now so nearby matches are focused without delay */
+  search_step(lm);
+  if (lm->pat)
+    uv_idle_start(&search_idle, search_idle_cb);
+}
+
+// cached spans of the matches on line, filled during the search pass.
+// returns the number of spans starting at *first.
+int regex_spans(LineMatch *lm, int line, MatchSpan **first)
+{
+  if (!lm || !lm->spans)
+    return 0;
+
+  int lo = 0;
+  int hi = utarray_len(lm->spans);
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    MatchSpan *span = (MatchSpan*)utarray_eltptr(lm->spans, mid);
+    if (span->line < line)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  int n = 0;
+  int max = utarray_len(lm->spans);
+  *first = (MatchSpan*)utarray_eltptr(lm->spans, lo);
+  while (lo + n < max && (*first)[n].line == line)
+    n++;
+  return n;
+}
+
+bool regex_running(LineMatch *lm)
+{
+  return lm && lm->pat;
+}
+
+void regex_cancel(LineMatch *lm)
+{
+  if (!regex_running(lm))
+    return;
+  regex_del_matches(lm);
+}
+
 void regex_build(LineMatch *lm, const char *line)
 {
   log_msg("REGEX", "build");
   log_msg("REGEX", ":%s:", line);
-  pcre *pcre = NULL;
-  pcre_extra *extra = NULL;
 
   if (line)
     SWAP_ALLOC_PTR(gcomp, strdup(line));
@@ -97,51 +349,26 @@ void regex_build(LineMatch *lm, const char *line)
     return;
   lm->gcomp = gcomp;
 
-  regex_compile(gcomp, &pcre, &extra);
-
   regex_del_matches(lm);
   utarray_new(lm->lines, &ut_int_icd);
-
-  int max = model_count(lm->hndl->model);
-  for (int i = 0; i < max; i++) {
-    int substr[NSUBEXP];
-    const char *match;
-
-    char* subject = model_str_line(lm->hndl->model, i);
-
-    int ret = pcre_exec(pcre,
-        extra,
-        subject,
-        strlen(subject),  // length of string
-        0,                // Start looking at this point
-        0,                // OPTIONS
-        substr,
-        NSUBEXP);         // Length of substr
-
-    if (ret == 0)
-      ret = NSUBEXP / 3;
-    if (ret > -1) {
-      pcre_get_substring(subject, substr, ret, 0, &(match));
-
-      for(int j = 0; j < ret; j++) {
-        if (substr[j*2+1] > 0) {
-          utarray_push_back(lm->lines, &i);
-          break;
-        }
-      }
-      pcre_free_substring(match);
-    }
-  }
-  pcre_free(extra);
-  pcre_free(pcre);
+  utarray_new(lm->spans, &span_icd);
+  search_start(lm, regex_pat_new(gcomp));
 }
 
 void regex_del_matches(LineMatch *lm)
 {
   log_msg("REGEX", "regex_del_matches");
+  search_stop(lm);
   if (lm->lines)
     utarray_free(lm->lines);
+  if (lm->spans)
+    utarray_free(lm->spans);
   lm->lines = NULL;
+  lm->spans = NULL;
+  lm->hover = false;
+  lm->cur = -1;
+  signal_matches(lm);
+  buf_refresh(lm->hndl->buf);
 }
 
 Pattern* regex_pat_new(const char *regex)
@@ -160,28 +387,8 @@ void regex_pat_delete(Pattern *pat)
 
 bool regex_match(Pattern *pat, const char *line)
 {
-  if (!line)
-    return false;
-
-  int substr[NSUBEXP];
-  const char *match;
-  bool succ = false;
-  int ret = pcre_exec(pat->pcre,
-      pat->extra,
-      line,
-      strlen(line),     // length of string
-      0,                // Start looking at this point
-      0,                // OPTIONS
-      substr,
-      NSUBEXP);         // Length of substr
-  if (ret == 0)
-    ret = NSUBEXP / 3;
-  if (ret > -1) {
-    pcre_get_substring(line, substr, ret, 0, &(match));
-    succ = true;
-    pcre_free_substring(match);
-  }
-  return succ;
+  MatchJob job = {NULL, pat, NULL, NULL, false, 0};
+  return line_hit(&job, line, NULL);
 }
 
 static int focus_cur_line(LineMatch *lm)
@@ -197,15 +404,30 @@ static void ensure_global_match(LineMatch *lm)
   }
 }
 
-static int* nearest_next_match(UT_array *matches, int line)
+// index of the first match on or below line; the match count if none.
+int regex_match_pos(LineMatch *lm, int line)
 {
-  log_msg("REGEX", "nearest_next_match");
-  int *it = NULL;
-  while ((it = (int*)utarray_next(matches, it))) {
-    if (*it == line || *it > line)
-      break;
+  if (!lm || !lm->lines)
+    return 0;
+
+  int lo = 0;
+  int hi = utarray_len(lm->lines);
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (*(int*)utarray_eltptr(lm->lines, mid) < line)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  return it;
+  return lo;
+}
+
+// line of the idx'th match, or -1.
+int regex_match_at(LineMatch *lm, int idx)
+{
+  if (!lm || !lm->lines || idx < 0 || idx >= utarray_len(lm->lines))
+    return -1;
+  return *(int*)utarray_eltptr(lm->lines, idx);
 }
 
 static void regex_focus(LineMatch *lm, int to)
@@ -231,23 +453,29 @@ void regex_mk_pivot(LineMatch *lm)
   lm->pivot_lnum = buf_line(lm->hndl->buf);
 }
 
+static void focus_match(LineMatch *lm, int idx)
+{
+  regex_focus(lm, regex_match_at(lm, idx));
+  lm->cur = idx;
+  signal_matches(lm);
+}
+
 void regex_hover(LineMatch *lm)
 {
-  int line = focus_cur_line(lm);
+  int count = MAX(0, regex_match_count(lm));
+  int idx = regex_match_pos(lm, focus_cur_line(lm));
 
-  if (!lm->lines || utarray_len(lm->lines) < 1) {
-    regex_pivot(lm);
-    return;
+  /* a nearer match may still be found */
+  if (idx == count && lm->pat) {
+    lm->hover = true;
+    return regex_pivot(lm);
   }
+  lm->hover = false;
 
-  int *ret = nearest_next_match(lm->lines, line);
-  if (ret)
-    regex_focus(lm, *ret);
-  else {
-    ret = (int*)utarray_next(lm->lines, ret); \
-    ret = ret ? ret : (int*)utarray_next(lm->lines, ret);
-    regex_focus(lm, *ret);
-  }
+  if (count < 1)
+    return regex_pivot(lm);
+
+  focus_match(lm, idx % count);
 }
 
 // pivot buffernode focus to closest match.
@@ -257,26 +485,32 @@ int regex_next(LineMatch *lm, int line, int dir)
 {
   log_msg("REGEX", "regex_next");
   ensure_global_match(lm);
-  if (!lm->lines || utarray_len(lm->lines) < 1)
+  if (!lm->lines || (utarray_len(lm->lines) < 1 && !lm->pat))
     return -1;
 
-  int *ret = nearest_next_match(lm->lines, line);
-  if (!ret)
-    ret = (int*)utarray_front(lm->lines);
+  int count = utarray_len(lm->lines);
+  int idx = regex_match_pos(lm, line);
 
-  if (ret && *ret == line) {
-    if (gregsign * dir > 0) {
-      ret = (int*)utarray_next(lm->lines, ret); \
-      ret = ret ? ret : (int*)utarray_next(lm->lines, ret);
-    }
-    else {
-      ret = (int*)utarray_prev(lm->lines, ret); \
-      ret = ret ? ret : (int*)utarray_prev(lm->lines, ret);
-    }
+  if (count < 1) {
+    regex_mk_pivot(lm);
+    lm->hover = true;
+    return -1;
   }
-  if (ret) {
-    regex_focus(lm, *ret);
-    return utarray_eltidx(lm->lines, ret);
+
+  if (gregsign * dir > 0) {
+    if (regex_match_at(lm, idx) == line)
+      idx++;
+    if (idx == count && lm->pat) {
+      /* focus next match when the running search reaches it */
+      regex_mk_pivot(lm);
+      lm->hover = true;
+      return -1;
+    }
+    idx = idx % count;
   }
-  return -1;
+  else
+    idx = (idx + count - 1) % count;
+
+  focus_match(lm, idx);
+  return idx;
 }
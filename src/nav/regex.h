@@ -6,15 +6,24 @@
 typedef struct LineMatch LineMatch;
 typedef struct Pattern Pattern;
 
+typedef struct {
+  int line;
+  int so;   //byte offset of match
+  int len;  //byte length of match
+} MatchSpan;
+
 LineMatch* regex_new(Handle *hndl);
 void regex_destroy(Handle *hndl);
 void regex_build(LineMatch *lm, const char *);
 void regex_del_matches(LineMatch *lm);
 void regex_setsign(int sign);
+bool regex_running(LineMatch *lm);
+void regex_cancel(LineMatch *lm);
 
 Pattern* regex_pat_new(const char *);
 void regex_pat_delete(Pattern *pat);
 bool regex_match(Pattern *pat, const char *);
+void regex_match_lines(Pattern *pat, Model *m, char *hits);
 
 void regex_mk_pivot(LineMatch *lm);
 void regex_pivot(LineMatch *lm);
@@ -22,6 +31,9 @@ void regex_pivot(LineMatch *lm);
 void regex_hover(LineMatch *lm);
 int regex_next(LineMatch *lm, int line, int dir);
 char* regex_str(LineMatch *lm);
+int regex_spans(LineMatch *lm, int line, MatchSpan **first);
 int regex_match_count(LineMatch *lm);
+int regex_match_pos(LineMatch *lm, int line);
+int regex_match_at(LineMatch *lm, int idx);
 
 #endif
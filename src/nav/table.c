@@ -487,6 +487,15 @@ static void pop_ventry(Ventry *it, TblVal *val, Ventry **cur)
   it = NULL;
 }
 
+/* move a listener off a record leaving its value */
+static void lis_relink(TblVal *val, TblRec *rec)
+{
+  TblLis *ll;
+  HASH_FIND_STR(val->fld->lis, val->key, ll);
+  if (ll && ll->rec == rec)
+    ll->rec = val->rlist->rec;
+}
+
 static Ventry* tbl_del_rec(Table *t, TblRec *rec, Ventry *cur)
 {
   log_msg("TABLE", "delete_rec()");
@@ -513,8 +522,10 @@ static Ventry* tbl_del_rec(Table *t, TblRec *rec, Ventry *cur)
 
         free(it);
       }
-      else
+      else {
         pop_ventry(it, val, &cur);
+        lis_relink(val, rec);
+      }
     }
   }
   LIST_REMOVE(rec, ent);
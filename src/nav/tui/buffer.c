@@ -170,6 +170,20 @@ void buf_update_progress(Buffer *buf, long percent)
   overlay_progress(buf->ov, percent);
 }
 
+void buf_update_scan(Buffer *buf, int count)
+{
+  if (!buf)
+    return;
+  overlay_scan(buf->ov, count);
+}
+
+void buf_update_xfer(Buffer *buf, const char *str)
+{
+  if (!buf)
+    return;
+  overlay_xfer(buf->ov, str);
+}
+
 void buf_set_plugin(Buffer *buf, Plugin *plugin, enum scr_type type)
 {
   log_msg("BUFFER", "buf_set_plugin");
@@ -216,6 +230,13 @@ void buf_signal_filter(Buffer *buf, int count)
   overlay_filter(buf->ov, max, count);
 }
 
+void buf_signal_matches(Buffer *buf, int idx, int count, bool running)
+{
+  if (!buf)
+    return;
+  overlay_matches(buf->ov, idx, count, running);
+}
+
 void buf_refresh(Buffer *buf)
 {
   log_msg("BUFFER", "refresh");
@@ -225,6 +246,21 @@ void buf_refresh(Buffer *buf)
   window_req_draw(buf, buf_draw);
 }
 
+/* match counter follows the cursor onto and off of matches */
+static void draw_match_pos(Buffer *buf)
+{
+  LineMatch *lm = buf->matches;
+  int count = regex_match_count(lm);
+  if (count < 1)
+    return;
+
+  int line = buf_index(buf);
+  int idx = regex_match_pos(lm, line);
+  if (regex_match_at(lm, idx) != line)
+    idx = -1;
+  overlay_matches(buf->ov, idx, count, regex_running(lm));
+}
+
 void buf_draw(void **argv)
 {
   log_msg("BUFFER", "draw");
@@ -243,6 +279,7 @@ void buf_draw(void **argv)
     return;
   }
   overlay_lnum(buf->ov, buf_index(buf), model_count(buf->hndl->model));
+  draw_match_pos(buf);
   draw_screen(buf);
   wnoutrefresh(buf->nc_win);
 }
@@ -298,6 +335,8 @@ static void buf_search(Buffer *buf, Keyarg *ca)
   char *str = regex_str(buf->matches);
   if (!str)
     nv_err("No search string");
+  else if (next == -1 && regex_running(buf->matches))
+    nv_msg("Searching: %s", str);
   else if (next == -1)
     nv_err("No matches: %s", str);
   else if (count == 1)
@@ -492,6 +531,7 @@ static void buf_esc(Buffer *buf, Keyarg *ca)
 {
   log_msg("BUFFER", "buf_esc");
   buf_end_sel(buf);
+  regex_cancel(buf->matches);
 }
 
 void buf_sort(Buffer *buf, char *fld, int flags)
@@ -57,12 +57,15 @@ void buf_set_linematch(Buffer *buf, LineMatch *match);
 void buf_set_status(Buffer *buf, char *, char *, char *);
 
 void buf_update_progress(Buffer *buf, long);
+void buf_update_scan(Buffer *buf, int);
+void buf_update_xfer(Buffer *buf, const char *);
 void buf_full_invalidate(Buffer *buf, int index, int lnum);
 int buf_input(Buffer *bn, Keyarg *ca);
 
 void buf_refresh(Buffer *buf);
 void buf_toggle_focus(Buffer *buf, int focus);
 void buf_signal_filter(Buffer *buf, int count);
+void buf_signal_matches(Buffer *buf, int idx, int count, bool running);
 
 void buf_move_invalid(Buffer *buf, int index, int lnum);
 void buf_move(Buffer *buf, int y, int x);
@@ -245,8 +245,10 @@ static void ex_update()
 
 static void ex_esc()
 {
-  if (ex.ex_state == EX_REG_STATE)
+  if (ex.ex_state == EX_REG_STATE) {
+    regex_cancel(ex.lm);
     regex_pivot(ex.lm);
+  }
 
   hist_save(ex.line, utarray_len(ex.cmd.tokens));
   ex.state = EX_QUIT;
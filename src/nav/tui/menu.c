@@ -78,7 +78,7 @@ void menu_ch_dir(void **args)
     return;
 
   char *dir = args[1];
-  uv_stat_t *stat = args[2];
+  struct stat *stat = args[2];
   if (!dir || !stat || !S_ISDIR(stat->st_mode)) {
     compl_invalidate(ex_cmd_curpos());
     return;
@@ -88,22 +88,6 @@ void menu_ch_dir(void **args)
   fs_open(cur_menu->fs, dir);
 }
 
-static int expand_path(char **path)
-{
-  char *dir = fs_trypath(*path);
-  if (!dir)
-    return 0;
-
-  if (strcmp(dir, *path)) {
-    free(*path);
-    *path = dir;
-  }
-  else
-    free(dir);
-
-  return 1;
-}
-
 void path_list()
 {
   log_msg("MENU", "path_list");
@@ -130,11 +114,9 @@ void path_list()
     return;
   }
 
-  bool exec = expand_path(&path);
-
+  /* fs_read expands and resolves off the loop; a path that does not
+   * resolve invalidates the completion in menu_ch_dir */
   if (compl_validate(ex_cmd_curpos()) || ex_cmd_curch() != '/') {
-    exec = true;
-
     char *cur = fs_pwd();
     if (strcmp(path, cur) && !strcmp(path, ".."))
       cur = fs_parent_dir(path);
@@ -143,9 +125,7 @@ void path_list()
 
     SWAP_ALLOC_PTR(path, strdup(cur));
   }
-  if (exec)
-    fs_read(cur_menu->fs, path);
-
+  fs_read(cur_menu->fs, path);
   free(path);
 }
 
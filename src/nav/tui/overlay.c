@@ -8,6 +8,7 @@
 #define SZ_LBL      8
 #define SZ_ARGS     8
 #define SZ_LN       10
+#define SZ_MATCH    32
 #define ST_ARG()    (SZ_LBL)
 #define ST_PRG()    ((SZ_LBL)-1)
 #define ST_LN(col)  ((col)-((SZ_ARGS)-1))
@@ -33,6 +34,9 @@ struct Overlay {
   char bufno[SZ_BUF];
   char name[SZ_LBL];
   char lineno[SZ_LN];
+  char matches[SZ_MATCH];
+  char scan[SZ_MATCH];
+  char xfer[SZ_MATCH];
 
   short col_lbl;
   short col_text;
@@ -126,6 +130,7 @@ void overlay_erase(Overlay *ov)
   set_string(&ov->pipe_in, "");
   memset(ov->name,   ' ', SZ_LBL);
   memset(ov->lineno, ' ', SZ_LN);
+  ov->matches[0] = '\0';
 }
 
 void overlay_focus(Overlay *ov)
@@ -186,6 +191,41 @@ void overlay_filter(Overlay *ov, int max, bool enable)
   ov->filter = strlen(szbuf);
 }
 
+void overlay_matches(Overlay *ov, int idx, int count, bool running)
+{
+  char *more = running ? "+" : "";
+  char str[SZ_MATCH] = {0};
+  if (count >= 0 && (idx < 0 || idx >= count))
+    snprintf(str, SZ_MATCH, " -/%d%s ", count, more);
+  else if (count >= 0)
+    snprintf(str, SZ_MATCH, " %d/%d%s ", idx+1, count, more);
+
+  if (!strcmp(str, ov->matches))
+    return;
+  strcpy(ov->matches, str);
+  overlay_refresh(ov);
+}
+
+void overlay_scan(Overlay *ov, int count)
+{
+  char str[SZ_MATCH] = {0};
+  if (count >= 0)
+    snprintf(str, SZ_MATCH, " %d+ ", count);
+
+  if (!strcmp(str, ov->scan))
+    return;
+  strcpy(ov->scan, str);
+  overlay_refresh(ov);
+}
+
+void overlay_xfer(Overlay *ov, const char *str)
+{
+  if (!strcmp(str, ov->xfer))
+    return;
+  snprintf(ov->xfer, SZ_MATCH, "%s", str);
+  overlay_refresh(ov);
+}
+
 void overlay_edit(Overlay *ov, char *name, char *usr, char *in)
 {
   log_msg("OVERLAY", "edit: %s ", name);
@@ -254,6 +294,26 @@ static void overlay_draw_labels(Overlay *ov)
   draw_wide(ov->nc_st, 0, ST_ARG(), ov->arg, SZ_USR(x));
   mvwchgat (ov->nc_st, 0, ST_ARG(), pos, A_NORMAL, ov->col_text, NULL);
 
+  int len = strlen(ov->matches);
+  if (len > 0 && pos - len > ST_ARG()) {
+    draw_wide(ov->nc_st, 0, pos - len, ov->matches, len);
+    mvwchgat (ov->nc_st, 0, pos - len, len, A_NORMAL, ov->col_arg, NULL);
+  }
+
+  int slen = strlen(ov->scan);
+  int spos = pos - len - slen;
+  if (slen > 0 && spos > ST_ARG()) {
+    draw_wide(ov->nc_st, 0, spos, ov->scan, slen);
+    mvwchgat (ov->nc_st, 0, spos, slen, A_NORMAL, ov->col_prog, NULL);
+  }
+
+  int xlen = strlen(ov->xfer);
+  int xpos = spos - xlen;
+  if (xlen > 0 && xpos > ST_ARG()) {
+    draw_wide(ov->nc_st, 0, xpos, ov->xfer, xlen);
+    mvwchgat (ov->nc_st, 0, xpos, xlen, A_NORMAL, ov->col_prog, NULL);
+  }
+
   draw_wide(ov->nc_st, 0, pos, ov->lineno, SZ_ARGS+1);
   mvwchgat (ov->nc_st, 0, pos,  -1, A_NORMAL, ov->col_lbl, NULL);
   mvwchgat (ov->nc_st, 0, pos+5, ov->filter, A_NORMAL, ov->col_fil, NULL);
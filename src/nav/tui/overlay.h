@@ -12,8 +12,11 @@ void overlay_set(Overlay *ov, pos_T size, pos_T ofs, int sep);
 void overlay_bufno(Overlay *ov, int id);
 void overlay_lnum(Overlay *ov, int lnum, int max);
 void overlay_filter(Overlay *ov, int max, bool enable);
+void overlay_matches(Overlay *ov, int idx, int count, bool running);
 void overlay_edit(Overlay *ov, char *, char *, char *);
 void overlay_progress(Overlay *ov, long);
+void overlay_scan(Overlay *ov, int count);
+void overlay_xfer(Overlay *ov, const char *str);
 void overlay_draw(void **argv);
 void overlay_erase(Overlay *ov);
 void overlay_focus(Overlay *ov);
@@ -13,6 +13,7 @@ static short col_unfocus;
 static short col_text;
 static short col_dir;
 static short col_sz;
+static short col_search;
 
 void screen_init()
 {
@@ -21,6 +22,42 @@ void screen_init()
   col_text    = opt_color(BUF_TEXT);
   col_dir     = opt_color(BUF_DIR);
   col_sz      = opt_color(BUF_SZ);
+  col_search  = opt_color(BUF_SEARCH);
+}
+
+static int cell_width(const char *str, int bytes)
+{
+  char *sub = strndup(str, bytes);
+  int width = cell_len(sub);
+  free(sub);
+  return width;
+}
+
+static void draw_spans(Buffer *buf, Model *m, int max)
+{
+  for (int i = 0; i < buf->b_size.lnum; ++i) {
+    MatchSpan *span;
+    int count = regex_spans(buf->matches, buf->top + i, &span);
+    if (count < 1)
+      continue;
+
+    char *it = model_str_line(m, buf->top + i);
+    if (!it)
+      break;
+
+    attr_t attr = A_NORMAL;
+    if (select_has_line(buf, buf->top + i))
+      attr = A_REVERSE;
+
+    for (int j = 0; j < count; j++) {
+      int st = cell_width(it, span[j].so);
+      int len = cell_width(it + span[j].so, span[j].len);
+      if (st >= max)
+        break;
+      len = MIN(len, max - st);
+      mvwchgat(buf->nc_win, i, st, len, attr, col_search, NULL);
+    }
+  }
 }
 
 static void draw_simple(Buffer *buf, Model *m)
@@ -132,10 +169,12 @@ void draw_screen(Buffer *buf)
     case SCR_SIMPLE:
       draw_simple(buf, m);
       draw_curline(buf);
+      draw_spans(buf, m, MAX_POS(buf->b_size.col) - 1);
       break;
     case SCR_FILE:
       draw_file(buf, m);
       draw_curline(buf);
+      draw_spans(buf, m, MAX_POS(buf->b_size.col) - 1);
       break;
     case SCR_OUT:
       draw_out(buf, m);
@@ -20,10 +20,12 @@ struct Window {
   int refs;
   Plugin *term;
   Buffer *alt_focus;
+  nv_fs *cd;        //resolves :cd with no buffer
 };
 
 static Cmdret win_version();
 static Cmdret win_new();
+static Cmdret win_jobs();
 static Cmdret win_shut();
 static Cmdret win_close();
 static Cmdret win_sort();
@@ -53,6 +55,7 @@ static Cmd_T cmdtable[] = {
   {"echo","ec",         "Print expression.",       win_echo,      0},
   {"edit","ed",         "Edit selection",          win_edit,      0},
   {"filter","fil",      "Filter buffer.",          win_filter,    0},
+  {"jobs",0,            "List file jobs.",         win_jobs,      MOVE_UP},
   {"mark","m",          "Mark a directory.",       win_mark,      0},
   {"new",0,             "Open horizontal window.", win_new,       MOVE_UP},
   {"qa",0,              "Quit all.",               win_shut,      0},
@@ -125,10 +128,22 @@ void window_init(void)
   buf_init();
 }
 
+static void win_cd_cb(void **args)
+{
+  char *path = args[1];
+  struct stat *stat = args[2];
+  if (stat)
+    fs_cwd(path);
+  else
+    nv_err("not a valid path: %s", path);
+}
+
 void window_cleanup(void)
 {
   log_msg("CLEANUP", "window_cleanup");
   layout_cleanup(&win.layout);
+  if (win.cd)
+    fs_cleanup(win.cd);
   buf_cleanup();
   plugin_cleanup();
 }
@@ -221,16 +236,15 @@ Cmdret win_cd(List *args, Cmdarg *ca)
   if (buf)
     plugin = buf_plugin(buf);
 
+  /* resolved off the loop; win_cd_cb reports an invalid path */
   if (!plugin) {
-    char *newpath = fs_trypath(path);
-    if (newpath) {
-      fs_cwd(newpath);
-      free(newpath);
-    }
-    else {
-      nv_err("not a valid path: %s", path);
-      return NORET;
+    if (!win.cd) {
+      win.cd = fs_init(NULL);
+      win.cd->stat_cb = win_cd_cb;
     }
+    if (path)
+      fs_read(win.cd, path);
+    return NORET;
   }
 
   if (plugin)
@@ -303,6 +317,14 @@ Cmdret win_new(List *args, Cmdarg *ca)
   return (Cmdret){RET_INT, .val.v_int = id};
 }
 
+Cmdret win_jobs(List *args, Cmdarg *ca)
+{
+  log_msg("WINDOW", "win_jobs");
+  window_add_buffer(ca->flags);
+  int id = plugin_open("jobs", window_get_focus(), NULL);
+  return (Cmdret){RET_INT, .val.v_int = id};
+}
+
 Cmdret win_close(List *args, Cmdarg *ca)
 {
   log_msg("WINDOW", "win_close");
@@ -474,6 +496,13 @@ Cmdret win_edit(List *args, Cmdarg *ca)
 Cmdret win_filter(List *args, Cmdarg *ca)
 {
   log_msg("WINDOW", "win_filter");
+  Buffer *buf = window_get_focus();
+  if (!buf || !buf_attached(buf))
+    return NORET;
+
+  char *line = cmdline_line_from(ca->cmdline, 1);
+  filter_build(buf->filter, line ? line : "");
+  filter_update(buf->filter);
   return NORET;
 }
 
@@ -3,9 +3,20 @@
 #include <string.h>
 #include <stdlib.h>
 #include <malloc.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "nav/util.h"
 #include "nav/macros.h"
 
+#define SC_MATCH      16
+#define SC_GAP_START  -3
+#define SC_GAP_EXT    -1
+#define BONUS_BOUND   8
+#define BONUS_CAMEL   7
+#define BONUS_CONSEC  4
+#define FUZZY_MAXQ    64
+
 #define init_mb(state) memset(&state, 0, sizeof(state))
 #define reset_mbytes(state) init_mb(state)
 #define check_mbytes(wch,buffer,length,state) \
@@ -444,3 +455,98 @@ bool fuzzy_match(char *s, const char *accept)
   }
   return true;
 }
+
+// position of the next byte >= ofs equal to c, ignoring ascii case.
+// c must be lowercase. returns -1 when not found.
+static int fuzzy_find(const char *s, int len, int ofs, char c)
+{
+  int i = ofs;
+  bool alpha = c >= 'a' && c <= 'z';
+#ifdef __SSE2__
+  /* or-ing 0x20 folds only 'A'-'Z' onto 'a'-'z' for a letter target */
+  __m128i fold = _mm_set1_epi8(alpha ? 0x20 : 0);
+  __m128i want = _mm_set1_epi8(c);
+  for (; i + 16 <= len; i += 16) {
+    __m128i blk = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i eq = _mm_cmpeq_epi8(_mm_or_si128(blk, fold), want);
+    int mask = _mm_movemask_epi8(eq);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < len; i++) {
+    char ch = alpha ? TOLOWER_ASC(s[i]) : s[i];
+    if (ch == c)
+      return i;
+  }
+  return -1;
+}
+
+static int char_bonus(const char *s, int i)
+{
+  if (i == 0)
+    return BONUS_BOUND;
+  char prev = s[i-1];
+  if (strchr("/-_. ", prev))
+    return BONUS_BOUND;
+  if (prev >= 'a' && prev <= 'z' && s[i] >= 'A' && s[i] <= 'Z')
+    return BONUS_CAMEL;
+  return 0;
+}
+
+// fzf-style score of query as a subsequence of s, case-insensitive.
+// higher is better, -1 when s does not contain query.
+int fuzzy_score(const char *s, const char *query)
+{
+  char q[FUZZY_MAXQ];
+  int qlen = 0;
+  for (; query[qlen] && qlen < FUZZY_MAXQ; qlen++)
+    q[qlen] = TOLOWER_ASC(query[qlen]);
+  if (qlen == 0)
+    return 0;
+
+  /* rejection pass: earliest end of the subsequence */
+  int len = strlen(s);
+  int pos = -1;
+  for (int i = 0; i < qlen; i++) {
+    pos = fuzzy_find(s, len, pos + 1, q[i]);
+    if (pos < 0)
+      return -1;
+  }
+
+  /* walk back to the latest start for the shortest window */
+  int start = pos;
+  for (int i = qlen - 1; i >= 0; start--) {
+    if (TOLOWER_ASC(s[start]) == q[i])
+      i--;
+  }
+  start++;
+
+  int score = 0;
+  int qi = 0;
+  int prev = -2;
+  int run = 0;  //bonus of the first char in a consecutive run
+  bool gap = false;
+  for (int i = start; i <= pos && qi < qlen; i++) {
+    if (TOLOWER_ASC(s[i]) != q[qi]) {
+      score += gap ? SC_GAP_EXT : SC_GAP_START;
+      gap = true;
+      continue;
+    }
+    int bonus = char_bonus(s, i);
+    if (prev == i - 1) {
+      run = MAX(run, bonus);
+      bonus = MAX(bonus, MAX(run, BONUS_CONSEC));
+    }
+    else
+      run = bonus;
+    if (qi == 0)
+      bonus *= 2;
+
+    score += SC_MATCH + bonus;
+    prev = i;
+    gap = false;
+    qi++;
+  }
+  return score;
+}
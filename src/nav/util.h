@@ -24,5 +24,6 @@ char* strip_quotes(const char *);
 char* add_quotes(char *);
 int fuzzystrspn(const char *p, const char *s);
 bool fuzzy_match(char *, const char *);
+int fuzzy_score(const char *, const char *);
 
 #endif